@@ -0,0 +1,1157 @@
+/**
+ * @file Benchmark.cpp
+ * Micro benchmarks for the communication code. Run "bench" to execute all
+ * benchmarks or "bench <name> ..." to execute selected ones.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include "RoboCupGameControlData.h"
+#include "SPLStandardMessage.h"
+#include "UdpComm.h"
+#include "LocalTransport.h"
+#include "ImpairedTransport.h"
+#include "ClockSync.h"
+#include "Log.h"
+#include "SystemTime.h"
+#include "MatchLog.h"
+#include "DecodedGameState.h"
+#include "SpectatorServer.h"
+#include "ReturnAggregator.h"
+#include "GameCtrl.h"
+#include "PowerSaver.h"
+#include "PerfCounters.h"
+
+static const int BENCH_PORT = 38380; /**< First local port used by the benchmarks. */
+
+/** Returns the CPU time used by all threads of this process in ns. */
+static long long getCpuNanoseconds()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return ((long long) usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000
+         + ((long long) usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+}
+
+/**
+ * Prints the percentiles of a sorted series of durations.
+ * @param name The name of the measurement.
+ * @param ns The durations in ns. Will be sorted.
+ */
+static void report(const char* name, std::vector<long long>& ns)
+{
+  std::sort(ns.begin(), ns.end());
+  printf("%-32s p50 %8.2f us  p99 %8.2f us  max %8.2f us\n", name,
+         ns[ns.size() / 2] / 1000.0, ns[ns.size() * 99 / 100] / 1000.0, ns.back() / 1000.0);
+}
+
+/** Parameters of the echo thread of the wait benchmark. */
+struct Echo
+{
+  UdpComm* udp;
+  int count;
+};
+
+/** Returns every packet received to its sender. */
+static void* echo(void* param)
+{
+  Echo* e = (Echo*) param;
+  char buffer[64];
+  for(int i = 0; i < e->count;)
+    if(e->udp->wait(1000))
+    {
+      int size = e->udp->read(buffer, sizeof(buffer));
+      if(size > 0)
+      {
+        e->udp->write(buffer, size);
+        ++i;
+      }
+    }
+  return 0;
+}
+
+/**
+ * Measures the round trip time over the loopback device and the CPU time
+ * spent in epoll mode and low-latency mode.
+ */
+static void benchmarkWait()
+{
+  static const int COUNT = 10000;
+  for(int mode = 0; mode < 2; ++mode)
+  {
+    UdpComm client, server;
+    if(!client.bind("127.0.0.1", BENCH_PORT) || !client.setTarget("127.0.0.1", BENCH_PORT + 1) ||
+       !server.bind("127.0.0.1", BENCH_PORT + 1) || !server.setTarget("127.0.0.1", BENCH_PORT) ||
+       !client.setBlocking(false) || !server.setBlocking(false))
+      return;
+    if(mode)
+    {
+      client.setLowLatency(50);
+      server.setLowLatency(50);
+    }
+
+    Echo e = {&server, COUNT};
+    pthread_t thread;
+    pthread_create(&thread, 0, echo, &e);
+
+    std::vector<long long> ns;
+    ns.reserve(COUNT);
+    char buffer[64] = {0};
+    const long long cpuStart = getCpuNanoseconds();
+    const long long wallStart = getNanoseconds();
+    for(int i = 0; i < COUNT; ++i)
+    {
+      const long long start = getNanoseconds();
+      client.write(buffer, sizeof(RoboCupGameControlReturnData));
+      while(!client.wait(1000) || client.read(buffer, sizeof(buffer)) <= 0)
+        ;
+      ns.push_back(getNanoseconds() - start);
+    }
+    const double wall = (double) (getNanoseconds() - wallStart);
+    const double cpu = (double) (getCpuNanoseconds() - cpuStart);
+    pthread_join(thread, 0);
+
+    report(mode ? "wait/low-latency round trip" : "wait/epoll round trip", ns);
+    printf("%-32s cpu %6.1f %%  %8.2f us cpu per round trip\n", mode ? "wait/low-latency" : "wait/epoll",
+           cpu / wall * 100.0, cpu / COUNT / 1000.0);
+  }
+}
+
+/**
+ * Measures the time per send() to a connected target versus sendto() to an
+ * unconnected one. The packets go to a bound socket that is never read.
+ */
+static void benchmarkSend()
+{
+  static const int COUNT = 200000;
+  UdpComm sink;
+  if(!sink.bind("127.0.0.1", BENCH_PORT + 2))
+    return;
+  for(int connected = 0; connected < 2; ++connected)
+  {
+    UdpComm sender;
+    if(!sender.setTarget("127.0.0.1", BENCH_PORT + 2, connected != 0))
+      return;
+    RoboCupGameControlReturnData packet;
+    const long long start = getNanoseconds();
+    for(int i = 0; i < COUNT; ++i)
+      sender.write((const char*) &packet, sizeof(packet));
+    const long long ns = getNanoseconds() - start;
+    printf("%-32s %8.1f ns/op  (%u sent, %u failed)\n", connected ? "send/connected" : "send/unconnected",
+           (double) ns / COUNT, sender.getStats().sent, sender.getStats().failed);
+  }
+}
+
+/**
+ * Sends GameController-sized packets through an impaired in-process link at
+ * 2000 packets per second, i.e. 1000 times faster than the GameController,
+ * and reports what arrives. A gap of four intervals corresponds to the
+ * GameController timeout in real time.
+ */
+static void benchmarkImpairment()
+{
+  static const int COUNT = 4000;
+  static const int INTERVAL = 500; // µs
+
+  struct Profile
+  {
+    const char* name;
+    ImpairedTransport::Impairment impairment;
+  };
+  Profile profiles[3];
+  profiles[0].name = "impairment/lan";
+  profiles[0].impairment.delay = 200;
+  profiles[0].impairment.jitter = 50;
+  profiles[1].name = "impairment/wifi";
+  profiles[1].impairment.loss = 0.05f;
+  profiles[1].impairment.duplication = 0.01f;
+  profiles[1].impairment.delay = 2000;
+  profiles[1].impairment.jitter = 1000;
+  profiles[1].impairment.distribution = ImpairedTransport::normal;
+  profiles[2].name = "impairment/competition wifi";
+  profiles[2].impairment.loss = 0.2f;
+  profiles[2].impairment.duplication = 0.02f;
+  profiles[2].impairment.reordering = 0.05f;
+  profiles[2].impairment.reorderDelay = 3000;
+  profiles[2].impairment.delay = 3000;
+  profiles[2].impairment.jitter = 1000;
+  profiles[2].impairment.distribution = ImpairedTransport::pareto;
+  profiles[2].impairment.bandwidth = 8000000; // the packets need 3.9 Mbit/s
+
+  for(const Profile& profile : profiles)
+  {
+    LocalTransport sender, receiver;
+    LocalTransport::connect(sender, receiver);
+    ImpairedTransport impaired(receiver, profile.impairment, ImpairedTransport::Impairment(), 42);
+
+    std::vector<long long> ns;
+    std::vector<bool> seen(COUNT, false);
+    int unique = 0, reordered = 0, timeouts = 0, last = -1;
+    long long lastArrival = 0;
+    RoboCupGameControlData packet;
+    memset(&packet, 0, sizeof(packet));
+    const long long start = getNanoseconds();
+    for(int sent = 0; sent < COUNT || impaired.wait(20);)
+    {
+      const long long now = getNanoseconds();
+      if(sent < COUNT && now >= start + sent * INTERVAL * 1000LL)
+      {
+        memcpy(&packet, &sent, sizeof(sent));
+        memcpy((char*) &packet + sizeof(sent), &now, sizeof(now));
+        sender.write((const char*) &packet, sizeof(packet));
+        ++sent;
+      }
+      impaired.wait(0);
+      while(impaired.read((char*) &packet, sizeof(packet)) > 0)
+      {
+        int number;
+        long long when;
+        memcpy(&number, &packet, sizeof(number));
+        memcpy(&when, (char*) &packet + sizeof(number), sizeof(when));
+        const long long arrival = getNanoseconds();
+        ns.push_back(arrival - when);
+        if(seen[number])
+          continue;
+        seen[number] = true;
+        ++unique;
+        if(number < last)
+          ++reordered;
+        else
+          last = number;
+        if(lastArrival && arrival - lastArrival > 4 * INTERVAL * 1000LL)
+          ++timeouts;
+        lastArrival = arrival;
+      }
+    }
+
+    report(profile.name, ns);
+    printf("%-32s %5.1f %% delivered  %d reordered  %d timeouts\n", profile.name,
+           unique * 100.0 / COUNT, reordered, timeouts);
+  }
+}
+
+/**
+ * Synchronizes with a simulated host whose clock is ahead by 1.5 s and runs
+ * 100 ppm faster, over an in-process link with wifi-like delays, and reports
+ * the errors of the estimates.
+ */
+static void benchmarkClockSync()
+{
+  static const long long OFFSET = 1500000; // µs
+  static const double DRIFT = 100e-6;
+  static const int DURATION = 5000; // ms
+
+  LocalTransport client, host;
+  LocalTransport::connect(client, host);
+  ImpairedTransport::Impairment impairment;
+  impairment.delay = 2000;
+  impairment.jitter = 1000;
+  impairment.distribution = ImpairedTransport::pareto;
+  impairment.loss = 0.05f;
+  ImpairedTransport impaired(client, impairment, impairment, 42);
+
+  const long long start = getNanoseconds() / 1000;
+  Clock hostClock = [] {const long long t = getNanoseconds() / 1000; return t + OFFSET + (long long) (t * DRIFT);};
+  ClockSyncServer server(host, hostClock);
+  ClockSync sync(impaired, 1, 1, 50);
+  while(getNanoseconds() / 1000 - start < DURATION * 1000LL)
+  {
+    sync.update();
+    server.update();
+    impaired.wait(1);
+  }
+
+  const long long now = getNanoseconds() / 1000;
+  printf("%-32s offset error %6lld us  drift error %7.2f ppm%s  round trip %6lld us\n", "clocksync",
+         sync.toHostTime(now) - hostClock(), sync.getDrift() - DRIFT * 1e6,
+         sync.isDriftEstimated() ? "" : " (not estimated)", sync.getRoundTrip());
+}
+
+/**
+ * Measures the time of a log call compared to formatting the same message
+ * with fprintf. Both write to /dev/null.
+ */
+static void benchmarkLog()
+{
+  static const int COUNT = 1000; // fits into the ring buffer of the thread
+  FILE* null = fopen("/dev/null", "w");
+  if(!null)
+    return;
+  Log::setOutput(null);
+  LOG("warm up"); // registers the thread and touches its ring buffer
+  Log::flush();
+  for(int i = 0; i < 2; ++i)
+  {
+    const long long start = getNanoseconds();
+    for(int j = 0; j < COUNT; ++j)
+      if(i)
+        fprintf(null, "packet %d state %d from %s\n", j, STATE_PLAYING, "10.0.0.1");
+      else
+        LOG("packet %d state %d from %s", j, STATE_PLAYING, "10.0.0.1");
+    const long long ns = getNanoseconds() - start;
+    printf("%-32s %8.1f ns/op\n", i ? "log/fprintf" : "log/deferred", (double) ns / COUNT);
+    Log::flush();
+  }
+
+  // Single calls between packets, when the caches are cold and the background thread sleeps.
+  for(int i = 0; i < 2; ++i)
+  {
+    long long ns = 0;
+    for(int j = 0; j < COUNT / 10; ++j)
+    {
+      usleep(1000);
+      const long long start = getNanoseconds();
+      if(i)
+        fprintf(null, "packet %d state %d from %s\n", j, STATE_PLAYING, "10.0.0.1");
+      else
+        LOG("packet %d state %d from %s", j, STATE_PLAYING, "10.0.0.1");
+      ns += getNanoseconds() - start;
+    }
+    printf("%-32s %8.1f ns/op\n", i ? "log/fprintf isolated" : "log/deferred isolated", (double) ns / (COUNT / 10));
+    Log::flush();
+  }
+  printf("%-32s %u dropped\n", "log/deferred", Log::getNumOfDropped());
+  Log::setOutput(stderr);
+  fclose(null);
+}
+
+/**
+ * Synthesizes the packets of a match: the GameController packets at 2 Hz
+ * through two halves with penalties and goals, and, if selected, a
+ * message per second from each of ten robots.
+ * @param entries The packets are appended here in the order of arrival.
+ * @param teamMessages Add team messages?
+ */
+static void synthesizeMatch(std::vector<MatchLogEntry>& entries, bool teamMessages)
+{
+  struct Phase
+  {
+    uint8_t state;
+    int duration; // s
+    bool firstHalf;
+  };
+  static const Phase phases[] =
+  {
+    {STATE_INITIAL, 60, true}, {STATE_READY, 45, true}, {STATE_SET, 10, true}, {STATE_PLAYING, 600, true},
+    {STATE_FINISHED, 30, true}, {STATE_INITIAL, 600, false}, {STATE_READY, 45, false}, {STATE_SET, 10, false},
+    {STATE_PLAYING, 600, false}, {STATE_FINISHED, 60, false}
+  };
+
+  srand(42);
+  RoboCupGameControlData data;
+  memset(&data, 0, sizeof(data));
+  memcpy(data.header, GAMECONTROLLER_STRUCT_HEADER, sizeof(data.header));
+  data.version = GAMECONTROLLER_STRUCT_VERSION;
+  data.playersPerTeam = 5;
+  data.dropInTime = 0xffff;
+  data.teams[0].teamNumber = 2;
+  data.teams[1].teamNumber = 7;
+  data.teams[1].teamColour = TEAM_RED;
+  data.kickOffTeam = 2;
+
+  SPLStandardMessage messages[10];
+  for(int i = 0; i < 10; ++i)
+  {
+    messages[i].playerNum = (int8_t) (i % 5 + 1);
+    messages[i].teamNum = (int8_t) data.teams[i / 5].teamNumber;
+    messages[i].fallen = 0;
+    messages[i].pose[0] = (float) (i % 5 * 800 - 1600);
+    messages[i].numOfDataBytes = 20;
+  }
+  const int messageSize = (int) offsetof(SPLStandardMessage, data) + 20;
+
+  MatchLogEntry entry;
+  long long second = 0;
+  for(const Phase& phase : phases)
+  {
+    data.state = phase.state;
+    data.firstHalf = phase.firstHalf;
+    data.secsRemaining = 600;
+    data.secondaryTime = (uint16_t) (phase.state == STATE_PLAYING ? 0 : phase.duration);
+    for(int s = 0; s < phase.duration; ++s, ++second)
+    {
+      if(data.secondaryTime)
+        --data.secondaryTime;
+      if(phase.state == STATE_PLAYING)
+      {
+        --data.secsRemaining;
+        if(data.dropInTime != 0xffff)
+          ++data.dropInTime;
+        if(rand() % 60 == 0)
+        {
+          data.dropInTeam = data.teams[rand() % 2].teamNumber;
+          data.dropInTime = 0;
+        }
+        if(rand() % 300 == 0)
+          ++data.teams[rand() % 2].score;
+        RobotInfo& robot = data.teams[rand() % 2].players[rand() % 5];
+        if(!robot.penalty && rand() % 40 == 0)
+        {
+          robot.penalty = (uint8_t) (rand() % 5 + 1);
+          robot.secsTillUnpenalised = 45;
+        }
+        for(TeamInfo& team : data.teams)
+          for(RobotInfo& player : team.players)
+            if(player.penalty && !--player.secsTillUnpenalised)
+              player.penalty = PENALTY_NONE;
+      }
+
+      for(int half = 0; half < 2; ++half)
+      {
+        ++data.packetNumber;
+        entry.type = MatchLogEntry::gameControlData;
+        entry.timestamp = second * 1000000 + half * 500000 + rand() % 4000 - 2000;
+        entry.size = sizeof(data);
+        entry.gameControl = data;
+        entries.push_back(entry);
+      }
+
+      if(teamMessages)
+        for(int i = 0; i < 10; ++i)
+        {
+          SPLStandardMessage& message = messages[i];
+          message.pose[0] += (float) (rand() % 101 - 50);
+          message.pose[1] += (float) (rand() % 101 - 50);
+          message.pose[2] = (float) (rand() % 628) / 100.f - 3.14f;
+          message.ballAge = (float) (rand() % 10) / 10.f;
+          message.ball[0] = (float) (rand() % 2000);
+          message.ball[1] = (float) (rand() % 2000 - 1000);
+          message.data[0] = (uint8_t) second;
+          entry.type = MatchLogEntry::teamMessage;
+          entry.timestamp = second * 1000000 + i * 97000 + rand() % 4000;
+          entry.size = messageSize;
+          memcpy(entry.data, &message, messageSize);
+          entries.push_back(entry);
+        }
+    }
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const MatchLogEntry& a, const MatchLogEntry& b) {return a.timestamp < b.timestamp;});
+}
+
+/**
+ * Writes synthetic matches with and without team messages to match logs
+ * and reports the compression ratio and the decoding throughput, both for
+ * the blocks written by a.out and for large blocks.
+ */
+static void benchmarkMatchLog()
+{
+  static const int REPEAT = 10;
+  static const int BLOCKS[] = {120, 1024}; // a.out writes 120 records per block
+  static const char* path = "/tmp/bench.matchlog";
+  for(int withTeam = 0; withTeam < 2; ++withTeam)
+  {
+    std::vector<MatchLogEntry> entries;
+    synthesizeMatch(entries, withTeam != 0);
+    long raw = 0;
+    for(const MatchLogEntry& entry : entries)
+      raw += entry.size;
+
+    for(int recordsPerBlock : BLOCKS)
+    {
+      MatchLogWriter writer(path, recordsPerBlock);
+      if(!writer.isOpen())
+        return;
+      for(const MatchLogEntry& entry : entries)
+        if(entry.type == MatchLogEntry::gameControlData)
+          writer.write(entry.gameControl, entry.timestamp);
+        else
+          writer.write(entry.getTeamMessage(), entry.size, entry.timestamp);
+      writer.close();
+
+      MatchLogEntry entry;
+      const long long start = getNanoseconds();
+      for(int i = 0; i < REPEAT; ++i)
+      {
+        MatchLogReader reader(path);
+        while(reader.read(entry))
+          ;
+      }
+      const double decode = (double) (getNanoseconds() - start) / REPEAT;
+
+      char name[64];
+      snprintf(name, sizeof(name), "matchlog/%s/%d", withTeam ? "with team messages" : "gamecontroller",
+               recordsPerBlock);
+      printf("%-32s %zu packets  %ld -> %ld bytes  ratio %6.1f  decode %8.1f MB/s (%6.2f ms)\n", name,
+             entries.size(), raw, writer.getSize(), (double) raw / writer.getSize(),
+             raw / decode * 1000.0, decode / 1e6);
+    }
+  }
+  remove(path);
+}
+
+/**
+ * Reads the fields used every cycle from many game states in random order,
+ * once from RoboCupGameControlData and once from DecodedGameState, and
+ * reports the time and the L1 data cache and last level cache misses per
+ * read side by side. Both working sets are larger than the L1 cache: the
+ * small one fits into L2, the large one not even into the last level
+ * cache. Without hardware counters, e.g. in a virtual machine, only the
+ * time is reported.
+ */
+static void benchmarkHotCold()
+{
+  static const int SIZES[] = {1 << 8, 1 << 15};
+  static const int READS = 1 << 20;
+  static const int TEAM = 2;
+  static const int PLAYER = 3;
+
+  PerfCounters counters;
+  if(!counters.isOpen())
+    printf("%-32s no hardware counters, times only\n", "hotcold");
+  for(int count : SIZES)
+  {
+    std::vector<RoboCupGameControlData> raw(count);
+    std::vector<DecodedGameState> decoded(count);
+    std::vector<int> order(count);
+    srand(42);
+    for(int i = 0; i < count; ++i)
+    {
+      RoboCupGameControlData& data = raw[i];
+      memset(&data, 0, sizeof(data));
+      data.state = (uint8_t) (rand() % 5);
+      data.kickOffTeam = TEAM;
+      const int own = rand() % 2;
+      data.teams[own].teamNumber = TEAM;
+      data.teams[own ^ 1].teamNumber = TEAM + 1;
+      data.teams[own].score = (uint8_t) (rand() % 3);
+      data.teams[own].players[PLAYER - 1].penalty = (uint8_t) (rand() % 3);
+      decoded[i].decode(data, TEAM, PLAYER);
+      order[i] = i;
+    }
+    for(int i = count - 1; i > 0; --i)
+      std::swap(order[i], order[rand() % (i + 1)]);
+
+    double ns[2];
+    long long values[2][PerfCounters::numOfCounters];
+    memset(values, 0, sizeof(values));
+    unsigned sum = 0;
+    for(int layout = 0; layout < 2; ++layout)
+    {
+      const long long start = getNanoseconds();
+      counters.start();
+      for(int pass = 0; pass < READS / count; ++pass)
+        for(int i : order)
+          if(layout)
+          {
+            const DecodedGameState& state = decoded[i];
+            sum += state.getState() + state.getSecondaryState() + state.getKickOffTeam() + state.getScore() +
+                   state.getPenalty();
+          }
+          else
+          {
+            const RoboCupGameControlData& data = raw[i];
+            const TeamInfo& team = data.teams[0].teamNumber == TEAM ? data.teams[0] : data.teams[1];
+            sum += data.state + data.secondaryState + data.kickOffTeam + team.score + team.players[PLAYER - 1].penalty;
+          }
+      counters.stop(values[layout]);
+      ns[layout] = (double) (getNanoseconds() - start) / READS;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "hotcold/%d states (%zu KB)", count,
+             (sizeof(RoboCupGameControlData) + sizeof(DecodedGameState)) * count / 1024);
+    printf("%-32s raw %6.1f ns/read", name, ns[0]);
+    for(PerfCounters::Counter counter : {PerfCounters::l1Misses, PerfCounters::llcMisses})
+      if(counters.isAvailable(counter))
+        printf(" %5.2f %s", (double) values[0][counter] / READS, PerfCounters::getName(counter));
+    printf("  decoded %6.1f ns/read", ns[1]);
+    for(PerfCounters::Counter counter : {PerfCounters::l1Misses, PerfCounters::llcMisses})
+      if(counters.isAvailable(counter))
+        printf(" %5.2f %s", (double) values[1][counter] / READS, PerfCounters::getName(counter));
+    printf("  (%u)\n", sum);
+  }
+}
+
+/**
+ * Measures the time to build, encode and send a spectator frame for
+ * growing numbers of subscribers. The subscribers are loopback addresses
+ * whose packets all go to a single socket that is never read.
+ */
+static void benchmarkSpectator()
+{
+  static const int FRAMES = 300;
+  static const int counts[] = {1, 10, 100, 1000};
+  UdpComm sink;
+  if(!sink.bind("0.0.0.0", BENCH_PORT + 5))
+    return;
+  for(int count : counts)
+  {
+    SpectatorServer server(BENCH_PORT + 4);
+    if(!server.isOpen())
+      return;
+    for(int i = 0; i < count; ++i)
+    {
+      struct sockaddr_in address;
+      memset(&address, 0, sizeof(address));
+      address.sin_family = AF_INET;
+      address.sin_port = htons(BENCH_PORT + 5);
+      address.sin_addr.s_addr = htonl(0x7f000001 + (i << 8)); // 127.0.i.1
+      server.subscribe(address, getNanoseconds() / 1000);
+    }
+    long long sent = 0;
+    const long long start = getNanoseconds();
+    for(int i = 0; i < FRAMES; ++i)
+      sent += server.tick(getNanoseconds() / 1000);
+    const double ns = (double) (getNanoseconds() - start) / FRAMES;
+    char name[64];
+    snprintf(name, sizeof(name), "spectator/%d subscribers", count);
+    printf("%-32s %8.2f us/frame  %6.2f us/subscriber  %5.1f %% sent\n", name, ns / 1000.0, ns / 1000.0 / count,
+           sent * 100.0 / FRAMES / count);
+  }
+}
+
+/**
+ * Measures the throughput of the GameController side of the return packets:
+ * adding packets from memory, reading bursts of packets queued on the
+ * loopback device, and the time from sending a penalise request until
+ * receive() reports it.
+ */
+static void benchmarkReturns()
+{
+  static const int TEAMS = 8; // four fields
+  static const int ADDS = 10000000;
+  static const int BURSTS = 2000;
+  static const int BURST = 128; // fits into the default receive buffer
+  static const int REQUESTS = 2000;
+
+  ReturnAggregator aggregator(BENCH_PORT + 6);
+  if(!aggregator.isOpen())
+    return;
+  RoboCupGameControlReturnData packets[TEAMS * MAX_NUM_PLAYERS];
+  for(int i = 0; i < TEAMS * MAX_NUM_PLAYERS; ++i)
+  {
+    packets[i].team = (uint8_t) (i / MAX_NUM_PLAYERS + 1);
+    packets[i].player = (uint8_t) (i % MAX_NUM_PLAYERS + 1);
+    packets[i].message = i % 50 ? GAMECONTROLLER_RETURN_MSG_ALIVE : GAMECONTROLLER_RETURN_MSG_MAN_PENALISE;
+  }
+
+  long long start = getNanoseconds();
+  for(int i = 0; i < ADDS; ++i)
+    aggregator.add((const char*) &packets[i % (TEAMS * MAX_NUM_PLAYERS)], sizeof(RoboCupGameControlReturnData), 0,
+                   start / 1000 + i);
+  double ns = (double) (getNanoseconds() - start);
+  printf("%-32s %8.2f Mpackets/s  %6.1f ns/packet\n", "returns/add", ADDS / ns * 1000.0, ns / ADDS);
+
+  UdpComm sender;
+  struct sockaddr_in target;
+  memset(&target, 0, sizeof(target));
+  target.sin_family = AF_INET;
+  target.sin_port = htons(BENCH_PORT + 6);
+  target.sin_addr.s_addr = htonl(0x7f000001);
+  std::vector<struct sockaddr_in> targets(BURST, target);
+  long long received = 0, sent = 0;
+  ns = 0;
+  for(int i = 0; i < BURSTS; ++i)
+  {
+    sent += sender.writeTo((const char*) &packets[i % (TEAMS * MAX_NUM_PLAYERS)], sizeof(RoboCupGameControlReturnData),
+                           targets.data(), BURST);
+    start = getNanoseconds();
+    for(int n; (n = aggregator.receive(start / 1000)) > 0;)
+      received += n;
+    ns += (double) (getNanoseconds() - start);
+  }
+  printf("%-32s %8.2f Mpackets/s  %6.1f ns/packet  %5.1f %% received\n", "returns/receive",
+         received / ns * 1000.0, ns / received, received * 100.0 / sent);
+
+  std::vector<long long> latencies;
+  latencies.reserve(REQUESTS);
+  RoboCupGameControlReturnData request;
+  request.team = 1;
+  request.player = 1;
+  request.message = GAMECONTROLLER_RETURN_MSG_MAN_PENALISE;
+  for(int i = 0; i < REQUESTS; ++i)
+  {
+    start = getNanoseconds();
+    sender.writeTo((const char*) &request, sizeof(request), &target, 1);
+    while(aggregator.receive(start / 1000) <= 0 || !aggregator.getNumOfRequests())
+      ;
+    latencies.push_back(getNanoseconds() - start);
+  }
+  report("returns/request latency", latencies);
+}
+
+/**
+ * Measures the throughput of streaming frames of the size of an
+ * SPLStandardMessage over the loopback device, sending and receiving each
+ * datagram separately versus passing bursts through the stack as single
+ * buffers with UDP_SEGMENT and UDP_GRO.
+ */
+static void benchmarkGso()
+{
+  static const int FRAME = sizeof(SPLStandardMessage);
+  static const int BURST = 64; // fits into the default receive buffer
+  static const int ROUNDS = 5000;
+  std::vector<char> frames(FRAME * BURST, 1);
+  std::vector<char> buffer(65536);
+  for(int segmented = 0; segmented < 2; ++segmented)
+  {
+    UdpComm sender, receiver;
+    if(!receiver.bind("127.0.0.1", BENCH_PORT + 7) || !receiver.setBlocking(false) ||
+       !sender.setTarget("127.0.0.1", BENCH_PORT + 7) || (segmented && !receiver.setGro(true)))
+      return;
+    long long received = 0;
+    int calls = 0;
+    const long long start = getNanoseconds();
+    for(int i = 0; i < ROUNDS; ++i)
+    {
+      if(segmented)
+        sender.writeSegmented(frames.data(), (int) frames.size(), FRAME);
+      else
+        for(int j = 0; j < BURST; ++j)
+          sender.write(frames.data() + j * FRAME, FRAME);
+      int size, segmentSize;
+      const char* messages[BURST];
+      int sizes[BURST];
+      while((size = segmented ? receiver.readSegmented(buffer.data(), (int) buffer.size(), &segmentSize)
+                              : receiver.read(buffer.data(), (int) buffer.size())) > 0)
+      {
+        received += segmented ? UdpComm::split(buffer.data(), size, segmentSize, messages, sizes, BURST) : 1;
+        ++calls;
+      }
+    }
+    const double ns = (double) (getNanoseconds() - start);
+    printf("%-32s %8.1f MB/s  %8.2f Mframes/s  %5.1f frames/read  %5.1f %% received\n",
+           segmented ? "gso/segmented" : "gso/separate", received * FRAME / ns * 1000.0, received / ns * 1000.0,
+           (double) received / calls, received * 100.0 / ROUNDS / BURST);
+  }
+}
+
+/** Returns a valid GameController packet addressed to team 2, the team of a.out. */
+static RoboCupGameControlData getStartupPacket()
+{
+  RoboCupGameControlData data;
+  memset(&data, 0, sizeof(data));
+  memcpy(data.header, GAMECONTROLLER_STRUCT_HEADER, sizeof(data.header));
+  data.version = GAMECONTROLLER_STRUCT_VERSION;
+  data.state = STATE_PLAYING;
+  data.teams[0].teamNumber = 2;
+  data.teams[1].teamNumber = 7;
+  return data;
+}
+
+/**
+ * Starts a.out and measures the time until it logs that it is ready and
+ * until it logs the state of the first packet, from the timestamps of its
+ * log. Like the GameController, a packet is sent every 500 ms, the first one
+ * right after the launch.
+ * @param activated Pass a socket bound in advance like systemd's socket activation does.
+ * @param ready The time to ready in ns is stored here.
+ * @param firstState The time to the first state in ns is stored here.
+ * @return Was the program started and did it receive a packet?
+ */
+static bool measureProcessStartup(bool activated, long long& ready, long long& firstState)
+{
+  int pipeFds[2];
+  if(pipe(pipeFds) == -1)
+    return false;
+  UdpComm sender;
+  sender.setTarget("127.0.0.1", GAMECONTROLLER_PORT);
+  UdpComm* listening = 0;
+  if(activated)
+  {
+    listening = new UdpComm();
+    if(!listening->bind("0.0.0.0", GAMECONTROLLER_PORT))
+    {
+      delete listening;
+      return false;
+    }
+  }
+
+  const long long start = getNanoseconds();
+  const pid_t pid = fork();
+  if(!pid)
+  {
+    dup2(pipeFds[1], 2);
+    if(listening)
+    {
+      dup2(listening->getSocket(), 3);
+      char buffer[16];
+      snprintf(buffer, sizeof(buffer), "%d", (int) getpid());
+      setenv("LISTEN_PID", buffer, 1);
+      setenv("LISTEN_FDS", "1", 1);
+    }
+    execl("./a.out", "./a.out", (char*) 0);
+    _exit(1);
+  }
+  close(pipeFds[1]);
+  delete listening;
+
+  const RoboCupGameControlData data = getStartupPacket();
+  ready = firstState = 0;
+  std::string output;
+  char buffer[256];
+  long long nextPacket = start;
+  for(long long now = start; !firstState && now - start < 2000000000LL; now = getNanoseconds())
+  {
+    if(now >= nextPacket)
+    {
+      sender.write((const char*) &data, sizeof(data));
+      nextPacket += 500000000LL;
+    }
+    struct pollfd p = {pipeFds[0], POLLIN, 0};
+    if(poll(&p, 1, 1) == 1)
+    {
+      const ssize_t size = read(pipeFds[0], buffer, sizeof(buffer));
+      if(size <= 0)
+        break;
+      output.append(buffer, size);
+    }
+    for(size_t begin = 0, end; (end = output.find('\n', begin)) != std::string::npos; begin = end + 1)
+    {
+      double timestamp;
+      char message[64];
+      if(sscanf(output.c_str() + begin, "[%lf] %63[^\n]", &timestamp, message) == 2)
+      {
+        const long long ns = (long long) (timestamp * 1e9) - start;
+        if(!strncmp(message, "Ready", 5))
+          ready = ns;
+        else if(!strcmp(message, "3"))
+          firstState = ns;
+      }
+    }
+  }
+  kill(pid, SIGKILL);
+  waitpid(pid, 0, 0);
+  close(pipeFds[0]);
+  return ready && firstState;
+}
+
+/**
+ * Measures the cold start: the setup of GameCtrl in this process and the
+ * time from launching a.out to ready and to the first state accepted, with
+ * a socket opened by the program and with a socket passed in advance.
+ */
+static void benchmarkStartup()
+{
+  static const int RUNS = 20;
+  static const int PROCESS_RUNS = 10;
+  const RoboCupGameControlData data = getStartupPacket();
+  std::vector<long long> ready, firstState;
+  for(int i = 0; i < RUNS; ++i)
+  {
+    UdpComm sender;
+    sender.setTarget("127.0.0.1", GAMECONTROLLER_PORT);
+    const long long start = getNanoseconds();
+    GameCtrl<DefaultLeague>* gamectl = new GameCtrl<DefaultLeague>();
+    gamectl->setTeamNumber(2);
+    ready.push_back(getNanoseconds() - start);
+    sender.write((const char*) &data, sizeof(data));
+    while(!gamectl->wait(1000) || !gamectl->receive())
+      ;
+    firstState.push_back(getNanoseconds() - start);
+    delete gamectl;
+  }
+  report("startup/GameCtrl ready", ready);
+  report("startup/GameCtrl first state", firstState);
+
+  if(access("./a.out", X_OK))
+  {
+    printf("%-32s skipped, ./a.out not found\n", "startup/process");
+    return;
+  }
+  for(int activated = 0; activated < 2; ++activated)
+  {
+    ready.clear();
+    firstState.clear();
+    for(int i = 0; i < PROCESS_RUNS; ++i)
+    {
+      long long r, f;
+      if(measureProcessStartup(activated != 0, r, f))
+      {
+        ready.push_back(r);
+        firstState.push_back(f);
+      }
+    }
+    if(ready.empty())
+      continue;
+    report(activated ? "startup/activated ready" : "startup/process ready", ready);
+    report(activated ? "startup/activated first state" : "startup/process first state", firstState);
+  }
+}
+
+/** Parameters of the GameController thread of the low power benchmark. */
+struct PacketSource
+{
+  uint8_t state; /**< The game state sent. */
+  bool silent; /**< Send nothing? */
+  long long end; /**< When to stop in ns. */
+  struct rusage usage; /**< The resources the thread used are stored here when it ends. */
+};
+
+/** Sends a packet to GameCtrl every 500 ms like the GameController does. */
+static void* sendPackets(void* param)
+{
+  PacketSource* source = (PacketSource*) param;
+  RoboCupGameControlData data = getStartupPacket();
+  data.state = source->state;
+  UdpComm sender;
+  sender.setTarget("127.0.0.1", GAMECONTROLLER_PORT);
+  while(getNanoseconds() < source->end)
+  {
+    if(!source->silent)
+    {
+      sender.write((const char*) &data, sizeof(data));
+      ++data.packetNumber;
+    }
+    usleep(500000);
+  }
+  getrusage(RUSAGE_THREAD, &source->usage);
+  return 0;
+}
+
+/**
+ * Runs the main loop of a.out with and without --low-power while the
+ * GameController sends packets in PLAYING, in INITIAL and not at all, and
+ * measures the wakeups and the CPU time of the process, i.e. of the loop and
+ * of the logger thread. The thread that plays the GameController is not
+ * counted.
+ */
+static void benchmarkLowPower()
+{
+  static const long long DURATION = 4000000000LL;
+  static const struct {const char* name; uint8_t state; bool silent;} scenarios[] =
+  {
+    {"playing", STATE_PLAYING, false},
+    {"initial", STATE_INITIAL, false},
+    {"silent", STATE_INITIAL, true}
+  };
+  for(const auto& scenario : scenarios)
+    for(int mode = 0; mode < 2; ++mode)
+    {
+      GameCtrl<DefaultLeague> gamectl;
+      static const int player = 1;
+      gamectl.playerNumber = &player;
+      gamectl.setTeamNumber(2);
+      PowerSaver* powerSaver = mode ? new PowerSaver() : 0;
+
+      struct rusage before, after;
+      getrusage(RUSAGE_SELF, &before);
+      const long long start = getNanoseconds();
+      PacketSource source = {scenario.state, scenario.silent, start + DURATION, {}};
+      pthread_t thread;
+      pthread_create(&thread, 0, sendPackets, &source);
+
+      int wakeups = 0, updates = 0;
+      while(getNanoseconds() < source.end)
+      {
+        if(powerSaver)
+        {
+          if(powerSaver->wait(gamectl.transport) && gamectl.whenPacketWasReceived)
+            gamectl.send(GAMECONTROLLER_RETURN_MSG_ALIVE);
+        }
+        else
+        {
+          gamectl.wait(ALIVE_DELAY);
+          if(gamectl.whenPacketWasReceived &&
+             (unsigned) (getMicroseconds() / 1000) - gamectl.whenPacketWasSent >= (unsigned) ALIVE_DELAY)
+            gamectl.send(GAMECONTROLLER_RETURN_MSG_ALIVE);
+        }
+        ++wakeups;
+        updates += gamectl.receive();
+        if(powerSaver)
+          powerSaver->update(gamectl.gameCtrlData.state, gamectl.whenPacketWasReceived &&
+                             (unsigned) (getMicroseconds() / 1000) - gamectl.whenPacketWasReceived < (unsigned) GAMECONTROLLER_TIMEOUT);
+      }
+      const double seconds = (double) (getNanoseconds() - start) / 1000000000.0;
+      pthread_join(thread, 0);
+      getrusage(RUSAGE_SELF, &after);
+      delete powerSaver;
+
+      const struct rusage& sender = source.usage;
+      const double cpu = ((double) (after.ru_utime.tv_sec - before.ru_utime.tv_sec + after.ru_stime.tv_sec - before.ru_stime.tv_sec
+                                   - sender.ru_utime.tv_sec - sender.ru_stime.tv_sec) * 1000000.0
+                          + (double) (after.ru_utime.tv_usec - before.ru_utime.tv_usec + after.ru_stime.tv_usec - before.ru_stime.tv_usec
+                                      - sender.ru_utime.tv_usec - sender.ru_stime.tv_usec)) / 1000000.0;
+      const long switches = after.ru_nvcsw - before.ru_nvcsw - sender.ru_nvcsw;
+      char name[64];
+      snprintf(name, sizeof(name), "lowpower/%s %s", scenario.name, mode ? "low power" : "default");
+      printf("%-32s %6.2f wakeups/s  %6.2f loop wakeups/s  cpu %7.4f %%  %d updates\n", name, switches / seconds,
+             wakeups / seconds, cpu / seconds * 100.0, updates);
+    }
+}
+
+/**
+ * A probe of GameCtrl::receive() that accumulates the time and the hardware
+ * performance counters of each stage.
+ */
+struct CounterProbe
+{
+  PerfCounters* counters = 0; /**< The counters read. 0 while nothing is measured. */
+  int stage = -1; /**< The stage running or -1. */
+  long long whenStarted = 0; /**< When the stage started in ns. */
+  long long values[numOfReceiveStages][PerfCounters::numOfCounters]; /**< The counts per stage. */
+  long long ns[numOfReceiveStages]; /**< The time per stage. */
+  int entries[numOfReceiveStages]; /**< How often each stage was entered. */
+
+  CounterProbe() {reset();}
+
+  void reset()
+  {
+    memset(values, 0, sizeof(values));
+    memset(ns, 0, sizeof(ns));
+    memset(entries, 0, sizeof(entries));
+  }
+
+  void begin(ReceiveStage next)
+  {
+    end();
+    if(counters)
+    {
+      stage = next;
+      ++entries[stage];
+      whenStarted = getNanoseconds();
+      counters->start();
+    }
+  }
+
+  void end()
+  {
+    if(stage != -1)
+    {
+      counters->stop(values[stage]);
+      ns[stage] += getNanoseconds() - whenStarted;
+      stage = -1;
+    }
+  }
+};
+
+/**
+ * Measures the stages of GameCtrl::receive() with the hardware performance
+ * counters: reading a packet from the socket, checking it, copying it,
+ * decoding it for this robot and handing it to the game clock, the history
+ * and the shootout tracker. The stages are marked by a probe compiled into
+ * receive(), so this is the real receive path including the rate limiter
+ * and the detection of duplicates. The cost of starting and stopping the
+ * counters is measured separately and subtracted. The system calls are only
+ * counted if kernel.perf_event_paranoid allows it. Without counters, e.g.
+ * in a virtual machine, only the time is reported.
+ */
+static void benchmarkCounters()
+{
+  static const int BATCH = 128;
+  static const int ROUNDS = 50;
+  static const int CALIBRATION = 10000;
+  static const char* stageNames[numOfReceiveStages] = {"read", "validate", "copy", "decode", "dispatch"};
+
+  UdpComm receiver, sender;
+  if(!receiver.bind("127.0.0.1", BENCH_PORT + 8) || !receiver.setBlocking(false) || !receiver.setPacketInfo(true) ||
+     !sender.setTarget("127.0.0.1", BENCH_PORT + 8))
+    return;
+  GameCtrl<DefaultLeague, CounterProbe>* gamectl = new GameCtrl<DefaultLeague, CounterProbe>();
+  static const int player = 1;
+  gamectl->playerNumber = &player;
+  gamectl->setTeamNumber(2);
+  gamectl->setTransport(&receiver);
+  gamectl->rateLimiter = RateLimiter(1e9f, 1e9f); // checked, but all packets pass
+  PerfCounters counters;
+
+  // The cost of the probe itself per stage.
+  CounterProbe& probe = gamectl->probe;
+  probe.counters = &counters;
+  for(int i = 0; i < CALIBRATION; ++i)
+    probe.begin(readStage);
+  probe.end();
+  long long overhead[PerfCounters::numOfCounters];
+  for(int i = 0; i < PerfCounters::numOfCounters; ++i)
+    overhead[i] = probe.values[readStage][i] / CALIBRATION;
+  const long long overheadNs = probe.ns[readStage] / CALIBRATION;
+  probe.reset();
+
+  int operations = 0;
+  RoboCupGameControlData data = getStartupPacket();
+  for(int round = 0; round < ROUNDS; ++round)
+  {
+    // The state and the penalty change, so the later stages have work to do.
+    for(int i = 0; i < BATCH; ++i)
+    {
+      ++data.packetNumber;
+      data.state = i % 2 ? STATE_PLAYING : STATE_READY;
+      data.teams[0].players[0].penalty = i / 4 % 2 ? PENALTY_SPL_PLAYER_PUSHING : PENALTY_NONE;
+      sender.write((const char*) &data, sizeof(data));
+    }
+    const unsigned first = gamectl->interfaces[0].first;
+    while(gamectl->receive())
+      ;
+    operations += (int) (gamectl->interfaces[0].first - first);
+  }
+  probe.counters = 0;
+
+  if(!operations)
+    return;
+  if(!counters.isOpen())
+    printf("%-32s no hardware counters, times only\n", "counters");
+  else if(!counters.countsKernel())
+    printf("%-32s user space only, system calls are excluded (kernel.perf_event_paranoid > 1)\n", "counters");
+  for(int stage = 0; stage < numOfReceiveStages; ++stage)
+  {
+    char name[64];
+    snprintf(name, sizeof(name), "counters/%s", stageNames[stage]);
+    const int entries = probe.entries[stage];
+    printf("%-32s %8.1f ns", name, (double) (probe.ns[stage] - overheadNs * entries) / operations);
+    long long values[PerfCounters::numOfCounters];
+    for(int i = 0; i < PerfCounters::numOfCounters; ++i)
+    {
+      values[i] = probe.values[stage][i] - overhead[i] * entries;
+      if(counters.isAvailable((PerfCounters::Counter) i))
+        printf("  %s %.1f", PerfCounters::getName((PerfCounters::Counter) i), (double) values[i] / operations);
+    }
+    if(counters.isAvailable(PerfCounters::cycles) && counters.isAvailable(PerfCounters::instructions) &&
+       values[PerfCounters::cycles] > 0)
+      printf("  IPC %.2f", (double) values[PerfCounters::instructions] / values[PerfCounters::cycles]);
+    printf("  per packet\n");
+  }
+  delete gamectl;
+}
+
+/** A benchmark that can be selected from the command line. */
+struct Benchmark
+{
+  const char* name;
+  void (*run)();
+};
+
+static const Benchmark benchmarks[] =
+{
+  {"wait", benchmarkWait},
+  {"send", benchmarkSend},
+  {"impairment", benchmarkImpairment},
+  {"clocksync", benchmarkClockSync},
+  {"log", benchmarkLog},
+  {"matchlog", benchmarkMatchLog},
+  {"hotcold", benchmarkHotCold},
+  {"spectator", benchmarkSpectator},
+  {"returns", benchmarkReturns},
+  {"gso", benchmarkGso},
+  {"startup", benchmarkStartup},
+  {"lowpower", benchmarkLowPower},
+  {"counters", benchmarkCounters}
+};
+
+int main(int argc, char* argv[])
+{
+  for(const Benchmark& benchmark : benchmarks)
+  {
+    bool selected = argc == 1;
+    for(int i = 1; i < argc; ++i)
+      selected |= !strcmp(argv[i], benchmark.name);
+    if(selected)
+      benchmark.run();
+  }
+  return 0;
+}
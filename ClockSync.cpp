@@ -0,0 +1,176 @@
+/**
+ * @file ClockSync.cpp
+ * Implements an NTP-like estimation of the offset and drift between the
+ * monotonic clock of a robot and the one of a designated host.
+ */
+
+#include "ClockSync.h"
+#include "Transport.h"
+#include "SystemTime.h"
+
+#include <math.h>
+#include <string.h>
+
+static const long long MIN_DRIFT_SPAN = 30000000; /**< Drift is only estimated from samples covering at least this many µs. */
+static const double MAX_DRIFT_ERROR = 5e-6; /**< Drift is only used if the standard error of its estimate is below this (µs per µs). */
+
+/**
+ * Checks whether a packet is a clock sync message.
+ */
+static bool isValid(const ClockSyncMessage& message, int size)
+{
+  return size == sizeof(message) &&
+         !memcmp(message.header, CLOCK_SYNC_STRUCT_HEADER, sizeof(message.header)) &&
+         message.version == CLOCK_SYNC_STRUCT_VERSION;
+}
+
+ClockSync::ClockSync(Transport& transport, uint8_t team, uint8_t player, int interval, Clock clock)
+: transport(transport),
+  team(team),
+  player(player),
+  interval(interval * 1000),
+  clock(clock ? clock : Clock(getMicroseconds)),
+  sequence(0),
+  whenRequestWasSent(0),
+  numOfSamples(0),
+  nextSample(0),
+  referenceTime(0),
+  offset(0.0),
+  drift(0.0),
+  driftEstimated(false)
+{}
+
+void ClockSync::update()
+{
+  ClockSyncMessage message;
+  int size;
+  while((size = transport.read((char*) &message, sizeof(message))) >= 0)
+  {
+    const long long t4 = clock();
+    if(isValid(message, size) && message.message == CLOCK_SYNC_MSG_RESPONSE &&
+       message.team == team && message.player == player && message.sequence == sequence)
+    {
+      Sample& sample = samples[nextSample];
+      sample.localTime = (message.t1 + t4) / 2;
+      sample.offset = ((message.t2 - message.t1) + (message.t3 - t4)) / 2;
+      sample.roundTrip = (t4 - message.t1) - (message.t3 - message.t2);
+      nextSample = (nextSample + 1) % maxNumOfSamples;
+      if(numOfSamples < maxNumOfSamples)
+        ++numOfSamples;
+      ++sequence; // Late duplicates of this response are ignored.
+      estimate();
+    }
+  }
+
+  const long long now = clock();
+  if(!whenRequestWasSent || now - whenRequestWasSent >= interval)
+  {
+    memset(&message, 0, sizeof(message));
+    memcpy(message.header, CLOCK_SYNC_STRUCT_HEADER, sizeof(message.header));
+    message.version = CLOCK_SYNC_STRUCT_VERSION;
+    message.message = CLOCK_SYNC_MSG_REQUEST;
+    message.team = team;
+    message.player = player;
+    message.sequence = ++sequence;
+    message.t1 = now;
+    transport.write((const char*) &message, sizeof(message));
+    whenRequestWasSent = now;
+  }
+}
+
+void ClockSync::estimate()
+{
+  // Only samples with a round trip close to the shortest one are used.
+  const long long shortest = getRoundTrip();
+  const long long tolerance = shortest / 2 > 100 ? shortest / 2 : 100;
+  const Sample* best = &samples[0];
+  for(int i = 1; i < numOfSamples; ++i)
+    if(samples[i].roundTrip < best->roundTrip)
+      best = &samples[i];
+
+  // Offsets are relative to the best one, so their squares do not lose precision.
+  int n = 0;
+  double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0, sumYY = 0.0;
+  long long first = 0, last = 0;
+  const long long reference = samples[(nextSample + maxNumOfSamples - 1) % maxNumOfSamples].localTime;
+  for(int i = 0; i < numOfSamples; ++i)
+  {
+    const Sample& sample = samples[i];
+    if(sample.roundTrip <= shortest + tolerance)
+    {
+      const double x = (double) (sample.localTime - reference);
+      const double y = (double) (sample.offset - best->offset);
+      sumX += x;
+      sumY += y;
+      sumXX += x * x;
+      sumXY += x * y;
+      sumYY += y * y;
+      if(!n || sample.localTime < first)
+        first = sample.localTime;
+      if(!n || sample.localTime > last)
+        last = sample.localTime;
+      ++n;
+    }
+  }
+
+  referenceTime = reference;
+  driftEstimated = false;
+  if(n >= 4 && last - first >= MIN_DRIFT_SPAN)
+  {
+    // The slope is only trusted if its standard error is small, otherwise
+    // extrapolating it would be worse than assuming no drift.
+    const double sxx = sumXX - sumX * sumX / n;
+    const double sxy = sumXY - sumX * sumY / n;
+    const double syy = sumYY - sumY * sumY / n;
+    const double slope = sxy / sxx;
+    const double residuals = syy - slope * sxy;
+    const double error = sqrt((residuals > 0.0 ? residuals : 0.0) / (n - 2) / sxx);
+    if(error < MAX_DRIFT_ERROR)
+    {
+      drift = slope;
+      offset = (double) best->offset + (sumY - drift * sumX) / n;
+      driftEstimated = true;
+    }
+  }
+  if(!driftEstimated)
+  {
+    drift = 0.0;
+    offset = (double) best->offset;
+  }
+}
+
+long long ClockSync::toHostTime(long long localTime) const
+{
+  return localTime + (long long) (offset + drift * (double) (localTime - referenceTime));
+}
+
+long long ClockSync::getRoundTrip() const
+{
+  long long shortest = numOfSamples ? samples[0].roundTrip : 0;
+  for(int i = 1; i < numOfSamples; ++i)
+    if(samples[i].roundTrip < shortest)
+      shortest = samples[i].roundTrip;
+  return shortest;
+}
+
+ClockSyncServer::ClockSyncServer(Transport& transport, Clock clock)
+: transport(transport),
+  clock(clock ? clock : Clock(getMicroseconds))
+{}
+
+void ClockSyncServer::update()
+{
+  ClockSyncMessage message;
+  int size;
+  while((size = transport.read((char*) &message, sizeof(message))) >= 0)
+  {
+    const long long t2 = clock();
+    if(isValid(message, size) && message.message == CLOCK_SYNC_MSG_REQUEST)
+    {
+      message.message = CLOCK_SYNC_MSG_RESPONSE;
+      message.t2 = t2;
+      message.t3 = clock();
+      transport.write((const char*) &message, sizeof(message));
+    }
+  }
+}
@@ -0,0 +1,161 @@
+/**
+ * @file ClockSync.h
+ * Declares an NTP-like estimation of the offset and drift between the
+ * monotonic clock of a robot and the one of a designated host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+class Transport;
+
+#define CLOCK_SYNC_PORT           3840
+
+#define CLOCK_SYNC_STRUCT_HEADER  "RClk"
+#define CLOCK_SYNC_STRUCT_VERSION 1
+
+#define CLOCK_SYNC_MSG_REQUEST    0
+#define CLOCK_SYNC_MSG_RESPONSE   1
+
+/**
+ * The packet exchanged. The client sets t1 when it sends a request. The
+ * host sets t2 when it receives the request and t3 when it sends the response.
+ * All times are in µs of the clock of the sender. Responses are broadcast,
+ * so team and player identify the client.
+ */
+struct ClockSyncMessage
+{
+  char header[4];    // CLOCK_SYNC_STRUCT_HEADER
+  uint8_t version;   // CLOCK_SYNC_STRUCT_VERSION
+  uint8_t message;   // CLOCK_SYNC_MSG_REQUEST or CLOCK_SYNC_MSG_RESPONSE
+  uint8_t team;      // team number of the client
+  uint8_t player;    // player number of the client
+  uint32_t sequence; // number of the request, copied to the response
+  uint32_t padding;
+  int64_t t1;        // when the request was sent (client clock)
+  int64_t t2;        // when the request was received (host clock)
+  int64_t t3;        // when the response was sent (host clock)
+};
+
+/** A clock returning µs. By default, the monotonic clock is used. */
+typedef std::function<long long()> Clock;
+
+/**
+ * @class ClockSync
+ * The client side. It regularly sends requests to the host and estimates
+ * the offset of the host clock and its drift from the responses. Only the
+ * responses with the shortest round trips are used, because they have the
+ * smallest error. Drift is the slope of a line fitted through their offsets.
+ * It is only used when the samples cover at least 30 s and the standard
+ * error of the slope is below 5 ppm. Otherwise, no drift is assumed.
+ */
+class ClockSync
+{
+public:
+  /**
+   * Constructor.
+   * @param transport The transport to the host. It must not block when reading.
+   * @param team The team number of this robot.
+   * @param player The player number of this robot.
+   * @param interval The time between two requests in ms.
+   * @param clock The local clock.
+   */
+  ClockSync(Transport& transport, uint8_t team, uint8_t player, int interval = 250, Clock clock = Clock());
+
+  /**
+   * Sends a request if it is due and handles all responses received.
+   * Should be called at least as often as requests are sent.
+   */
+  void update();
+
+  /**
+   * Is there an estimate of the offset?
+   */
+  bool isSynchronized() const {return numOfSamples > 0;}
+
+  /**
+   * Converts a time of the local clock into the host time base.
+   * @param localTime A time of the local clock in µs.
+   * @return The estimated time of the host clock at the same moment in µs.
+   */
+  long long toHostTime(long long localTime) const;
+
+  /**
+   * Returns the estimated offset host clock - local clock at the current time in µs.
+   */
+  long long getOffset() const {return toHostTime(clock()) - clock();}
+
+  /**
+   * Returns the estimated drift of the host clock relative to the local one
+   * in ppm, i.e. µs per second. 0 if it is not estimated.
+   */
+  double getDrift() const {return drift * 1000000.0;}
+
+  /**
+   * Is the drift estimated? Otherwise, the offset is assumed to be constant.
+   */
+  bool isDriftEstimated() const {return driftEstimated;}
+
+  /**
+   * Returns the shortest round trip time in the current window in µs.
+   */
+  long long getRoundTrip() const;
+
+private:
+  enum {maxNumOfSamples = 256}; /**< The size of the window of samples. 64 s at the default interval. */
+
+  /** The result of one request. */
+  struct Sample
+  {
+    long long localTime; /**< The local time the offset refers to in µs. */
+    long long offset; /**< The offset host clock - local clock in µs. */
+    long long roundTrip; /**< The round trip time without the processing on the host in µs. */
+  };
+
+  /**
+   * Fits the offset and drift to the best samples of the window.
+   */
+  void estimate();
+
+  Transport& transport; /**< The transport to the host. */
+  uint8_t team; /**< The team number of this robot. */
+  uint8_t player; /**< The player number of this robot. */
+  int interval; /**< The time between two requests in µs. */
+  Clock clock; /**< The local clock. */
+  uint32_t sequence; /**< The sequence number of the last request. */
+  long long whenRequestWasSent; /**< The local time of the last request in µs. */
+  Sample samples[maxNumOfSamples]; /**< The ring buffer of the samples. */
+  int numOfSamples; /**< The number of valid entries in samples. */
+  int nextSample; /**< The entry of samples that is written next. */
+  long long referenceTime; /**< The local time offset refers to in µs. */
+  double offset; /**< The estimated offset at referenceTime in µs. */
+  double drift; /**< The estimated drift in µs per µs. */
+  bool driftEstimated; /**< Is drift estimated or assumed to be 0? */
+};
+
+/**
+ * @class ClockSyncServer
+ * The host side. It answers all requests. For tests, it can run on a
+ * simulated clock with an offset and drift.
+ */
+class ClockSyncServer
+{
+public:
+  /**
+   * Constructor.
+   * @param transport The transport to the clients. It must not block when reading.
+   * @param clock The host clock.
+   */
+  ClockSyncServer(Transport& transport, Clock clock = Clock());
+
+  /**
+   * Answers all requests received.
+   */
+  void update();
+
+private:
+  Transport& transport; /**< The transport to the clients. */
+  Clock clock; /**< The host clock. */
+};
@@ -0,0 +1,56 @@
+/**
+ * @file DecodedGameState.cpp
+ * Implements a representation of a GameController packet that separates
+ * the fields read every cycle from the rest.
+ */
+
+#include "DecodedGameState.h"
+
+#include <string.h>
+
+DecodedGameState::DecodedGameState()
+{
+  memset(&hot, 0, sizeof(hot));
+  memset(&cold, 0, sizeof(cold));
+  hot.ownTeam = noTeam;
+}
+
+void DecodedGameState::decode(const RoboCupGameControlData& data, int teamNumber, int playerNumber)
+{
+  hot.state = data.state;
+  hot.secondaryState = data.secondaryState;
+  hot.firstHalf = data.firstHalf;
+  hot.kickOffTeam = data.kickOffTeam;
+  hot.packetNumber = data.packetNumber;
+  hot.secsRemaining = data.secsRemaining;
+  hot.secondaryTime = data.secondaryTime;
+  hot.ownTeam = noTeam;
+  hot.kickOff = false;
+  hot.teamColour = 0;
+  hot.score = 0;
+  hot.opponentScore = 0;
+  hot.penalty = PENALTY_NONE;
+  hot.secsTillUnpenalised = 0;
+  for(int i = 0; i < 2; ++i)
+    if(teamNumber && data.teams[i].teamNumber == teamNumber)
+    {
+      const TeamInfo& team = data.teams[i];
+      hot.ownTeam = (uint8_t) i;
+      hot.kickOff = data.kickOffTeam == teamNumber;
+      hot.teamColour = team.teamColour;
+      hot.score = team.score;
+      hot.opponentScore = data.teams[i ^ 1].score;
+      if(playerNumber >= 1 && playerNumber <= MAX_NUM_PLAYERS)
+      {
+        hot.penalty = team.players[playerNumber - 1].penalty;
+        hot.secsTillUnpenalised = team.players[playerNumber - 1].secsTillUnpenalised;
+      }
+      break;
+    }
+
+  cold.playersPerTeam = data.playersPerTeam;
+  cold.gameType = data.gameType;
+  cold.dropInTeam = data.dropInTeam;
+  cold.dropInTime = data.dropInTime;
+  memcpy(cold.teams, data.teams, sizeof(cold.teams));
+}
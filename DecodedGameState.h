@@ -0,0 +1,112 @@
+/**
+ * @file DecodedGameState.h
+ * Declares a representation of a GameController packet that separates the
+ * fields read every cycle from the rest.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "RoboCupGameControlData.h"
+
+/**
+ * @class DecodedGameState
+ * A RoboCupGameControlData decoded for a robot. The fields behaviour and
+ * LED code read every cycle, including the ones of the own team and robot,
+ * are packed into a single cache line. Everything else, i.e. the team
+ * infos with their coach messages, is kept in a cold area behind it.
+ * The own team and robot are resolved when decoding, so the accessors do
+ * not search.
+ */
+class DecodedGameState
+{
+public:
+  DecodedGameState();
+
+  /**
+   * Decodes a packet.
+   * @param data The packet.
+   * @param teamNumber The number of our team.
+   * @param playerNumber The number of this robot starting with 1. 0 if unknown.
+   */
+  void decode(const RoboCupGameControlData& data, int teamNumber, int playerNumber);
+
+  uint8_t getState() const {return hot.state;}
+  uint8_t getSecondaryState() const {return hot.secondaryState;}
+  uint8_t getFirstHalf() const {return hot.firstHalf;}
+  uint8_t getKickOffTeam() const {return hot.kickOffTeam;}
+  uint8_t getPacketNumber() const {return hot.packetNumber;}
+  uint16_t getSecsRemaining() const {return hot.secsRemaining;}
+  uint16_t getSecondaryTime() const {return hot.secondaryTime;}
+
+  /** Is our team one of the teams in the packet? */
+  bool hasOwnTeam() const {return hot.ownTeam != noTeam;}
+
+  /** Do we have the kick-off? */
+  bool hasKickOff() const {return hot.kickOff;}
+
+  /** Returns the colour of our team. Only valid if hasOwnTeam(). */
+  uint8_t getTeamColour() const {return hot.teamColour;}
+
+  /** Returns the score of our team. Only valid if hasOwnTeam(). */
+  uint8_t getScore() const {return hot.score;}
+
+  /** Returns the score of the other team. Only valid if hasOwnTeam(). */
+  uint8_t getOpponentScore() const {return hot.opponentScore;}
+
+  /** Returns the penalty of this robot. PENALTY_NONE if our team or this robot is unknown. */
+  uint8_t getPenalty() const {return hot.penalty;}
+
+  /** Returns the seconds until this robot is unpenalised. */
+  uint8_t getSecsTillUnpenalised() const {return hot.secsTillUnpenalised;}
+
+  /** Returns our team. Only valid if hasOwnTeam(). */
+  const TeamInfo& getOwnTeam() const {return cold.teams[hot.ownTeam];}
+
+  /** Returns the other team. Only valid if hasOwnTeam(). */
+  const TeamInfo& getOpponentTeam() const {return cold.teams[hot.ownTeam ^ 1];}
+
+  /** Returns a team by its index in the packet. */
+  const TeamInfo& getTeam(int index) const {return cold.teams[index];}
+
+  uint8_t getPlayersPerTeam() const {return cold.playersPerTeam;}
+  uint8_t getGameType() const {return cold.gameType;}
+  uint8_t getDropInTeam() const {return cold.dropInTeam;}
+  uint16_t getDropInTime() const {return cold.dropInTime;}
+
+private:
+  enum {noTeam = 0xff}; /**< The value of ownTeam if our team is not in the packet. */
+
+  /** The fields read every cycle. */
+  struct alignas(64) Hot
+  {
+    uint8_t state;
+    uint8_t secondaryState;
+    uint8_t firstHalf;
+    uint8_t kickOffTeam;
+    uint8_t packetNumber;
+    uint8_t ownTeam; /**< The index of our team in Cold::teams or noTeam. */
+    bool kickOff; /**< Do we have the kick-off? */
+    uint8_t teamColour; /**< The colour of our team. */
+    uint8_t score; /**< The score of our team. */
+    uint8_t opponentScore; /**< The score of the other team. */
+    uint8_t penalty; /**< The penalty of this robot. */
+    uint8_t secsTillUnpenalised; /**< The seconds until this robot is unpenalised. */
+    uint16_t secsRemaining;
+    uint16_t secondaryTime;
+  };
+  static_assert(sizeof(Hot) == 64, "The hot fields must fit into a cache line");
+
+  /** The fields rarely read. */
+  struct Cold
+  {
+    uint8_t playersPerTeam;
+    uint8_t gameType;
+    uint8_t dropInTeam;
+    uint16_t dropInTime;
+    TeamInfo teams[2];
+  };
+
+  Hot hot;
+  Cold cold;
+};
@@ -0,0 +1,65 @@
+/**
+ * @file DeltaCoding.cpp
+ * Implements the encoding of buffers as differences to a previous version.
+ */
+
+#include "DeltaCoding.h"
+
+void putVarint(std::vector<unsigned char>& out, uint64_t value)
+{
+  while(value >= 0x80)
+  {
+    out.push_back((unsigned char) (value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((unsigned char) value);
+}
+
+bool getVarint(const unsigned char*& p, const unsigned char* end, uint64_t& value)
+{
+  value = 0;
+  for(int shift = 0; p < end && shift < 64; shift += 7)
+  {
+    const unsigned char byte = *p++;
+    value |= (uint64_t) (byte & 0x7f) << shift;
+    if(!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+void putDelta(std::vector<unsigned char>& out, const char* data, const char* base, int size)
+{
+  for(int i = 0;;)
+  {
+    int start = i;
+    while(i < size && data[i] == base[i])
+      ++i;
+    putVarint(out, i - start);
+    if(i == size)
+      break;
+    start = i;
+    while(i < size && (data[i] != base[i] || (i + 1 < size && data[i + 1] != base[i + 1])))
+      ++i;
+    putVarint(out, i - start);
+    for(int j = start; j < i; ++j)
+      out.push_back((unsigned char) (data[j] ^ base[j]));
+  }
+}
+
+bool getDelta(const unsigned char*& p, const unsigned char* end, char* data, int size)
+{
+  for(uint64_t i = 0;;)
+  {
+    uint64_t length;
+    if(!getVarint(p, end, length) || length > size - i)
+      return false;
+    i += length;
+    if(i == (uint64_t) size)
+      return true;
+    if(!getVarint(p, end, length) || length > size - i || length > (uint64_t) (end - p))
+      return false;
+    for(const uint64_t last = i + length; i < last; ++i)
+      data[i] ^= (char) *p++;
+  }
+}
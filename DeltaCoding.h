@@ -0,0 +1,33 @@
+/**
+ * @file DeltaCoding.h
+ * Declares the encoding of buffers as differences to a previous version,
+ * which is shared by the match log and the spectator stream.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+/** Appends an unsigned number with 7 bits per byte. */
+void putVarint(std::vector<unsigned char>& out, uint64_t value);
+
+/**
+ * Reads an unsigned number with 7 bits per byte.
+ * @return Was it complete?
+ */
+bool getVarint(const unsigned char*& p, const unsigned char* end, uint64_t& value);
+
+/**
+ * Appends the XOR of two buffers as pairs of the length of a run of zeros
+ * and the length of the following bytes, followed by these bytes. Single
+ * zeros between differences are kept in the bytes, because a pair costs
+ * more. The sequence ends when the size is reached after a run of zeros.
+ */
+void putDelta(std::vector<unsigned char>& out, const char* data, const char* base, int size);
+
+/**
+ * Applies a delta written by putDelta() to a buffer.
+ * @return Was the delta valid?
+ */
+bool getDelta(const unsigned char*& p, const unsigned char* end, char* data, int size);
@@ -0,0 +1,105 @@
+/**
+ * @file GameClock.cpp
+ * Implements a local game clock that extrapolates the times of the
+ * GameController packets with the monotonic clock.
+ */
+
+#include "GameClock.h"
+#include "SystemTime.h"
+
+#include <string.h>
+
+static const long long SECOND = 1000000; /**< One second in µs. */
+
+GameClock::GameClock()
+: version(0),
+  running(0)
+{
+  memset(countdowns, 0, sizeof(countdowns));
+  for(std::atomic<long long>& deadline : deadlines)
+    deadline.store(0, std::memory_order_relaxed);
+}
+
+void GameClock::update(Countdown& countdown, int value, long long now)
+{
+  // The time reaches zero within a second after now + value.
+  const long long earliest = now + value * SECOND;
+  const long long latest = earliest + SECOND;
+  const bool decreased = countdown.valid && value < countdown.value;
+  const bool consistent = earliest < countdown.latest && latest > countdown.earliest;
+
+  if((countdown.running || decreased) && consistent)
+  {
+    // When the time starts, the window of the previous value also holds.
+    if(earliest > countdown.earliest)
+      countdown.earliest = earliest;
+    if(latest < countdown.latest)
+      countdown.latest = latest;
+    countdown.running = true;
+  }
+  else
+  {
+    countdown.running = false;
+    countdown.earliest = earliest;
+    countdown.latest = latest;
+  }
+  countdown.valid = true;
+  countdown.value = value;
+}
+
+void GameClock::update(const RoboCupGameControlData& data, int teamNumber, int playerNumber, long long now)
+{
+  int penaltyTime = 0;
+  for(const TeamInfo& team : data.teams)
+    if(team.teamNumber == teamNumber && playerNumber >= 1 && playerNumber <= MAX_NUM_PLAYERS)
+      penaltyTime = team.players[playerNumber - 1].secsTillUnpenalised;
+
+  update(countdowns[secsRemaining], data.secsRemaining, now);
+  update(countdowns[secondaryTime], data.secondaryTime, now);
+  update(countdowns[secsTillUnpenalised], penaltyTime, now);
+
+  unsigned runningBits = 0;
+  version.fetch_add(1, std::memory_order_acq_rel);
+  for(int i = 0; i < numOfTimes; ++i)
+  {
+    const Countdown& countdown = countdowns[i];
+    if(countdown.running)
+    {
+      runningBits |= 1u << i;
+      deadlines[i].store((countdown.earliest + countdown.latest) / 2, std::memory_order_relaxed);
+    }
+    else
+      deadlines[i].store(countdown.value * SECOND, std::memory_order_relaxed);
+  }
+  running.store(runningBits, std::memory_order_relaxed);
+  version.fetch_add(1, std::memory_order_release);
+}
+
+float GameClock::get(Time time, long long now) const
+{
+  unsigned before, after;
+  long long deadline;
+  bool isRunning;
+  do
+  {
+    before = version.load(std::memory_order_acquire);
+    deadline = deadlines[time].load(std::memory_order_relaxed);
+    isRunning = (running.load(std::memory_order_relaxed) >> time & 1) != 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = version.load(std::memory_order_relaxed);
+  }
+  while(before != after || before & 1);
+
+  const long long remaining = isRunning ? deadline - now : deadline;
+  return remaining > 0 ? (float) remaining / (float) SECOND : 0.f;
+}
+
+float GameClock::get(Time time) const
+{
+  return get(time, getMicroseconds());
+}
+
+bool GameClock::isRunning(Time time) const
+{
+  return (running.load(std::memory_order_acquire) >> time & 1) != 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file GameClock.h
+ * Declares a local game clock that extrapolates the times of the
+ * GameController packets with the monotonic clock.
+ */
+
+#pragma once
+
+#include <atomic>
+#include "RoboCupGameControlData.h"
+
+/**
+ * @class GameClock
+ * The GameController sends its times in whole seconds about twice a second.
+ * For each of them, this class estimates the moment on the local monotonic
+ * clock when the time reaches zero. Each packet constrains that moment to a
+ * window of one second. The windows of successive packets are intersected,
+ * so the estimate becomes more accurate with every change of the value seen.
+ * A time is considered running after it decreased and stopped when its value
+ * contradicts the window. A stopped time is reported as sent.
+ *
+ * update() must be called from a single thread. The getters can be called
+ * from any thread. They never block and only read the monotonic clock,
+ * which is served from the vDSO without a system call.
+ */
+class GameClock
+{
+public:
+  /** The times estimated. */
+  enum Time
+  {
+    secsRemaining, /**< RoboCupGameControlData::secsRemaining. */
+    secondaryTime, /**< RoboCupGameControlData::secondaryTime. */
+    secsTillUnpenalised, /**< RobotInfo::secsTillUnpenalised of this robot. */
+    numOfTimes
+  };
+
+  GameClock();
+
+  /**
+   * Adds the times of a packet.
+   * @param data The packet.
+   * @param teamNumber The number of our team.
+   * @param playerNumber The number of this robot starting with 1. 0 if unknown.
+   * @param now When the packet was received in µs of the monotonic clock.
+   */
+  void update(const RoboCupGameControlData& data, int teamNumber, int playerNumber, long long now);
+
+  /**
+   * Returns the estimate of a time.
+   * @param time The time.
+   * @param now The current time in µs of the monotonic clock.
+   * @return The time in seconds. Never negative.
+   */
+  float get(Time time, long long now) const;
+
+  /**
+   * Returns the estimate of a time now.
+   */
+  float get(Time time) const;
+
+  /** Is a time currently running? */
+  bool isRunning(Time time) const;
+
+private:
+  /** The estimation of a single time. Only used by the writer. */
+  struct Countdown
+  {
+    bool valid; /**< Was a value received? */
+    bool running; /**< Is the time running? */
+    int value; /**< The last value received in seconds. */
+    long long earliest; /**< The earliest moment the time can reach zero in µs. */
+    long long latest; /**< The latest moment the time can reach zero in µs (exclusive). */
+  };
+
+  /**
+   * Adds a value of a time to its estimation.
+   */
+  static void update(Countdown& countdown, int value, long long now);
+
+  Countdown countdowns[numOfTimes]; /**< The estimations. */
+
+  // The published estimates, protected by a sequence lock.
+  std::atomic<unsigned> version; /**< Odd while the estimates are written. */
+  std::atomic<long long> deadlines[numOfTimes]; /**< When a running time reaches zero or the value of a stopped one in µs. */
+  std::atomic<unsigned> running; /**< Bit i is set if time i is running. */
+};
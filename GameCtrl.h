@@ -0,0 +1,683 @@
+/**
+ * @file GameCtrl.h
+ * Implementation of a NAOqi library that communicates with the GameController.
+ * It provides the data received in ALMemory.
+ * It also implements the official button interface and sets the LEDs as
+ * specified in the rules.
+ *
+ * @author Thomas Röfer
+ */
+
+#pragma once
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#pragma clang diagnostic ignored "-Wunused-variable"
+#endif
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstring>
+#include <cstddef>
+#include <new>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <linux/filter.h>
+#include "RoboCupGameControlData.h"
+#include "UdpComm.h"
+#include "RateLimiter.h"
+#include "GameClock.h"
+#include "DecodedGameState.h"
+#include "GameStateHistory.h"
+#include "PenaltyShootout.h"
+#include "League.h"
+#include "Log.h"
+#include "SystemTime.h"
+
+static const int BUTTON_DELAY = 30; /**< Button state changes are ignored when happening in less than 30 ms. */
+static const int GAMECONTROLLER_TIMEOUT = 2000; /**< Connected to GameController when packet was received within the last 2000 ms. */
+static const int ALIVE_DELAY = 500; /**< Send an alive signal every 500 ms. */
+static const unsigned UDP_HEADER_SIZE = 8; /**< Socket filters see the UDP header before the payload. */
+static const int MAX_INTERFACES = 4; /**< The maximum number of interfaces packets are received on. */
+static const int RECENT_PACKETS = 16; /**< The number of packets remembered to detect copies from other interfaces. */
+static const int MAX_PACKETS_PER_RECEIVE = 32; /**< receive() handles at most this many packets per call. */
+static const float MAX_PACKET_RATE = 10.f; /**< Packets per second accepted from a single sender in the long run. */
+static const float MAX_PACKET_BURST = 20.f; /**< Packets accepted from a single sender in a row. */
+
+/** The stages of handling a packet in GameCtrl::receive(). */
+enum ReceiveStage
+{
+  readStage, /**< Reading from the transport. */
+  validateStage, /**< Checking interface, rate, size, header, version, team and duplicates. */
+  copyStage, /**< Making the packet the current one. */
+  decodeStage, /**< Finding what it means for this robot. */
+  dispatchStage, /**< Updating the game clock, the history and the shootout tracker. */
+  numOfReceiveStages
+};
+
+/**
+ * The default probe of GameCtrl::receive(). A probe is told when each stage
+ * begins and when the last one ends, e.g. to read performance counters per
+ * stage. This one does nothing, so the calls are compiled away.
+ */
+struct NoProbe
+{
+  void begin(ReceiveStage) {}
+  void end() {}
+};
+
+/**
+ * @class GameCtrl
+ * Receives the GameController packets, sends the return packets and sets the LEDs.
+ * @tparam League The league policy that interprets penalties and colours (see League.h).
+ * @tparam Probe Observes the stages of receive() (see NoProbe).
+ */
+template<typename League, typename Probe = NoProbe> class GameCtrl{
+
+public:
+  /**
+   * The colours of the LEDs as specified in the rules as 0xRRGGBB.
+   */
+  struct LEDs
+  {
+    unsigned chest; /**< The game state or red while penalised. */
+    unsigned leftFoot; /**< The team colour. */
+    unsigned rightFoot; /**< White if our team kicks off, off otherwise. */
+  };
+
+  /**
+   * An interface the GameController packets are received on and the
+   * statistics of the copies that arrived through it.
+   */
+  struct Interface
+  {
+    bool used; /**< Is this entry in use? */
+    int index; /**< The interface index. 0 if the transport does not report it. */
+    char name[IF_NAMESIZE]; /**< The name of the interface. */
+    bool listed; /**< Was it added with addInterface()? */
+    char broadcastAddress[INET_ADDRSTRLEN]; /**< The return packets are mirrored here. Empty if they are not. */
+    unsigned first; /**< The number of packets that arrived here first. */
+    unsigned duplicates; /**< The number of copies that arrived here later than on another interface. */
+    long long skewSum; /**< The sum of the delays of the duplicates behind the first copy in µs. */
+    long long maxSkew; /**< The maximum delay of a duplicate behind the first copy in µs. */
+  };
+
+  /**
+   * A packet recently accepted. Used to drop the copies arriving through other interfaces.
+   */
+  struct RecentPacket
+  {
+    uint8_t packetNumber; /**< The packet number of the packet. */
+    long long whenReceived; /**< When its first copy was received in µs. 0 if unused. */
+  };
+
+  /**
+   * Counters of the packets dropped by receive() by reason.
+   */
+  struct Drops
+  {
+    unsigned otherInterface; /**< Arrived through an interface not listened on. */
+    unsigned rateLimited; /**< Their sender exceeded its packet rate. */
+    unsigned tooManySenders; /**< The rate limiter could not track their sender. */
+    unsigned malformed; /**< Wrong size or header. */
+    unsigned wrongVersion; /**< Wrong version of the packet structure. */
+    unsigned otherTeam; /**< Not addressed to this team or the team number is unknown. */
+    unsigned duplicates; /**< Copies of packets already received through another interface. */
+    unsigned budgetExhausted; /**< Calls of receive() that stopped while packets were still queued. Not a drop. */
+  };
+
+//private:
+  UdpComm* udp; /**< The socket used to communicate. */
+  Transport* transport; /**< Packets are sent and received through this. Usually the socket. */
+  const int* playerNumber; /** Points to where ALMemory stores the player number. 0 if unknown. */
+  const int* teamNumberPtr; /** Points to where ALMemory stores the team number. The number be set to 0 after it was read. */
+  const int* defaultTeamColour; /** Points to where ALMemory stores the default team color. */
+  int teamNumber; /**< The team number. */
+  RoboCupGameControlData gameCtrlData; /**< The local copy of the GameController packet. */
+  uint8_t previousState; /**< The game state during the previous cycle. Used to detect when LEDs have to be updated. */
+  uint8_t previousSecondaryState; /**< The secondary game state during the previous cycle. Used to detect when LEDs have to be updated. */
+  uint8_t previousKickOffTeam; /**< The kick-off team during the previous cycle. Used to detect when LEDs have to be updated. */
+  uint8_t previousTeamColour; /**< The team colour during the previous cycle. Used to detect when LEDs have to be updated. */
+  uint8_t previousPenalty; /**< The penalty set during the previous cycle. Used to detect when LEDs have to be updated. */
+  unsigned whenPacketWasReceived; /**< When the last GameController packet was received (ms of the monotonic clock). */
+  unsigned whenPacketWasSent; /**< When the last return packet was sent to the GameController (ms of the monotonic clock). */
+  Interface interfaces[MAX_INTERFACES]; /**< The interfaces packets were received on. */
+  bool onlyListedInterfaces; /**< Are packets only accepted from interfaces added with addInterface()? */
+  RecentPacket recentPackets[RECENT_PACKETS]; /**< Ring buffer of the packets recently accepted. */
+  int nextRecentPacket; /**< The entry in recentPackets that is overwritten next. */
+  char broadcastAddress[INET_ADDRSTRLEN]; /**< The default target of return packets. */
+  RateLimiter rateLimiter; /**< Limits the packet rate per sender before packets are checked. */
+  Drops drops; /**< Why packets were dropped. */
+  GameClock gameClock; /**< The times of the last packet extrapolated. Can be read from any thread. */
+  DecodedGameState decoded; /**< The last packet accepted, decoded for our team and robot. */
+  GameStateHistory history; /**< The last packets accepted. Snapshots can be taken from any thread. */
+  PenaltyShootout shootout; /**< The state of the penalty shootout. */
+  LEDs leds; /**< The colours the LEDs should show. */
+  Probe probe; /**< Observes the stages of receive(). */
+
+  /**
+   * Resets the internal state when an application was just started.
+   */
+  void init()
+  {
+    previousState = (uint8_t) -1;
+    previousSecondaryState = (uint8_t) -1;
+    previousKickOffTeam = (uint8_t) -1;
+    previousTeamColour = (uint8_t) -1;
+    previousPenalty = (uint8_t) -1;
+    whenPacketWasReceived = 0;
+    whenPacketWasSent = 0;
+    memset(&gameCtrlData, 0, sizeof(gameCtrlData));
+    memset(&leds, 0, sizeof(leds));
+    memset(recentPackets, 0, sizeof(recentPackets));
+    nextRecentPacket = 0;
+  }
+
+  /**
+   * Returns the information about our team in the last packet.
+   * @return The team or 0 if the packet is not addressed to us.
+   */
+  const TeamInfo* getOwnTeam() const
+  {
+    for(const TeamInfo& team : gameCtrlData.teams)
+      if(teamNumber && team.teamNumber == teamNumber)
+        return &team;
+    return 0;
+  }
+
+  /**
+   * Returns the penalty of this robot in the last packet.
+   */
+  uint8_t getPenalty() const
+  {
+    const TeamInfo* team = getOwnTeam();
+    return team && playerNumber && *playerNumber >= 1 && *playerNumber <= MAX_NUM_PLAYERS
+           ? team->players[*playerNumber - 1].penalty : PENALTY_NONE;
+  }
+
+  /**
+   * Returns when the current penalty of this robot started according to the history.
+   * @return The time in µs of the monotonic clock or 0 if this robot is not
+   *         penalised or the history was overwritten while it was read. If
+   *         the penalty started before the oldest version, the time of the
+   *         oldest version is returned.
+   */
+  long long getPenaltyStart() const
+  {
+    if(!playerNumber || *playerNumber < 1 || *playerNumber > MAX_NUM_PLAYERS)
+      return 0;
+    const int player = *playerNumber - 1;
+    const int team = teamNumber;
+    return history.getStartOf([&](const GameState& state)
+    {
+      for(const GameState::Team& t : state.teams)
+        if(t.teamNumber == team)
+          return t.players[player].penalty != PENALTY_NONE;
+      return false;
+    });
+  }
+
+  /**
+   * Returns the name of the penalty of this robot in the last packet.
+   */
+  const char* getPenaltyName() const
+  {
+    return ::getPenaltyName<League>(getPenalty());
+  }
+
+  /**
+   * Updates the colours of the LEDs if anything shown changed since the previous call.
+   * @return Did the colours change?
+   */
+  bool updateLEDs()
+  {
+    if(!decoded.hasOwnTeam())
+      return false;
+
+    const uint8_t penalty = decoded.getPenalty();
+    if(decoded.getState() == previousState &&
+       decoded.getSecondaryState() == previousSecondaryState &&
+       decoded.getKickOffTeam() == previousKickOffTeam &&
+       decoded.getTeamColour() == previousTeamColour &&
+       penalty == previousPenalty)
+      return false;
+
+    previousState = decoded.getState();
+    previousSecondaryState = decoded.getSecondaryState();
+    previousKickOffTeam = decoded.getKickOffTeam();
+    previousTeamColour = decoded.getTeamColour();
+    previousPenalty = penalty;
+
+    leds.chest = penalty != PENALTY_NONE ? PENALISED_COLOUR
+                 : STATE_COLOURS[decoded.getState() <= STATE_FINISHED ? decoded.getState() : STATE_INITIAL];
+    leds.leftFoot = getTeamColour<League>(decoded.getTeamColour());
+    leds.rightFoot = decoded.hasKickOff() ? LED_WHITE : LED_OFF;
+    return true;
+  }
+
+  /**
+   * Restricts reception to an interface. Can be called for several interfaces.
+   * Before it is called, packets are accepted from all interfaces.
+   * Return packets are mirrored to the broadcast addresses of all interfaces added.
+   * @param name The name of the interface, e.g. "eth0" or "wlan0".
+   * @return Was the interface found?
+   */
+  bool addInterface(const char* name)
+  {
+    const int index = (int) if_nametoindex(name);
+    Interface* interface = index ? getInterface(index, true) : 0;
+    if(!interface)
+    {
+      LOG("libgamectrl: Cannot listen on interface %s", name);
+      return false;
+    }
+    interface->listed = true;
+    onlyListedInterfaces = true;
+    updateMirrors();
+    return true;
+  }
+
+  /**
+   * Looks up the broadcast addresses of the interfaces added with
+   * addInterface() again. Return packets are mirrored to those that differ
+   * from the default target. Interfaces without an address, e.g. because
+   * they are down, are skipped until they have one.
+   * @return Did any address change?
+   */
+  bool updateMirrors()
+  {
+    bool changed = false;
+    for(Interface& interface : interfaces)
+      if(interface.used && interface.listed)
+      {
+        const char* address = UdpComm::getBroadcastAddress(interface.name);
+        if(!address || !strcmp(address, broadcastAddress))
+          address = "";
+        if(strcmp(address, interface.broadcastAddress))
+        {
+          strcpy(interface.broadcastAddress, address);
+          changed = true;
+        }
+      }
+    if(changed && udp)
+    {
+      udp->clearTargets();
+      for(const Interface& interface : interfaces)
+        if(interface.used && interface.listed && *interface.broadcastAddress)
+          udp->addTarget(interface.broadcastAddress, GAMECONTROLLER_PORT);
+    }
+    return changed;
+  }
+
+  /**
+   * Returns the entry of an interface.
+   * @param index The interface index.
+   * @param create Create an entry if the interface was not seen before?
+   * @return The entry or 0 if there is none.
+   */
+  Interface* getInterface(int index, bool create)
+  {
+    for(Interface& interface : interfaces)
+      if(interface.used && interface.index == index)
+        return &interface;
+      else if(!interface.used)
+      {
+        if(!create)
+          return 0;
+        memset(&interface, 0, sizeof(interface));
+        interface.used = true;
+        interface.index = index;
+        if(!index || !if_indextoname(index, interface.name))
+          strcpy(interface.name, "?");
+        return &interface;
+      }
+    return 0;
+  }
+
+  /**
+   * Checks whether a packet is a copy of one recently received through another
+   * interface. If it is, its delay is added to the statistics of the interface.
+   * Otherwise, the packet is remembered.
+   * @param packetNumber The packet number of the packet.
+   * @param now The time of arrival in µs.
+   * @param interface The interface the packet arrived on.
+   * @return Is the packet a copy?
+   */
+  bool isDuplicate(uint8_t packetNumber, long long now, Interface& interface)
+  {
+    for(const RecentPacket& recent : recentPackets)
+      if(recent.whenReceived && recent.packetNumber == packetNumber &&
+         now - recent.whenReceived < GAMECONTROLLER_TIMEOUT * 1000LL)
+      {
+        const long long skew = now - recent.whenReceived;
+        ++interface.duplicates;
+        interface.skewSum += skew;
+        if(skew > interface.maxSkew)
+          interface.maxSkew = skew;
+        return true;
+      }
+
+    ++interface.first;
+    recentPackets[nextRecentPacket].packetNumber = packetNumber;
+    recentPackets[nextRecentPacket].whenReceived = now;
+    nextRecentPacket = (nextRecentPacket + 1) % RECENT_PACKETS;
+    return false;
+  }
+
+
+  /**
+   * Sends the return packet to the GameController.
+   * @param message The message contained in the packet (GAMECONTROLLER_RETURN_MSG_MAN_PENALISE,
+   *                GAMECONTROLLER_RETURN_MSG_MAN_UNPENALISE or GAMECONTROLLER_RETURN_MSG_ALIVE).
+   */
+  bool send(uint8_t message)
+  {
+    RoboCupGameControlReturnData returnPacket;
+    returnPacket.team = (uint8_t) teamNumber;
+    returnPacket.player = (uint8_t) (playerNumber ? *playerNumber : 0);
+    returnPacket.message = message;
+    whenPacketWasSent = (unsigned) (getMicroseconds() / 1000);
+    if(!transport)
+      return true;
+    const bool written = transport->write((const char*) &returnPacket, sizeof(returnPacket));
+
+    // A mirror may have failed even if the packet was written.
+    const int error = transport->getWriteError();
+    if(error == ENETUNREACH || error == EADDRNOTAVAIL)
+      updateBroadcastAddress(); // The network changed since the addresses were looked up.
+    return written;
+  }
+
+  /**
+   * Looks up the wifi broadcast address and the addresses of the mirrors
+   * again and sends the return packets there if they changed, e.g. because
+   * an interface was still down at the start or DHCP assigned another address.
+   * @return Did an address change?
+   */
+  bool updateBroadcastAddress()
+  {
+    if(!udp)
+      return false;
+    const char* address = UdpComm::getWifiBroadcastAddress(true);
+    const bool changed = strcmp(address, broadcastAddress) != 0;
+    if(changed)
+    {
+      LOG("libgamectrl: Broadcast address changed from %s to %s", broadcastAddress, address);
+      strncpy(broadcastAddress, address, sizeof(broadcastAddress) - 1);
+      udp->setTarget(broadcastAddress, GAMECONTROLLER_PORT);
+    }
+    return updateMirrors() || changed;
+  }
+
+  /**
+   * Sets the team number and installs a socket filter that lets the kernel
+   * drop all GameController packets not addressed to this team.
+   * @param number The team number. While it is 0, no packet is accepted.
+   */
+  void setTeamNumber(int number)
+  {
+    teamNumber = number;
+    decoded.decode(gameCtrlData, teamNumber, playerNumber ? *playerNumber : 0);
+    if(udp)
+      setFilter();
+  }
+
+  /**
+   * Generates and attaches a classic BPF program that performs the checks of
+   * receive() in the kernel: size, header, version and team number.
+   * receive() still checks everything, because packets queued before the
+   * filter was attached are not filtered.
+   * @return Was the filter attached?
+   */
+  bool setFilter()
+  {
+    // Instruction indices of the labels. Jump offsets count from the next instruction.
+    enum {LEN = 0, HEADER = 2, VERSION = 4, TEAM0 = 6, TEAM1 = 8, ACCEPT = 10, REJECT = 11};
+    const unsigned char* header = (const unsigned char*) GAMECONTROLLER_STRUCT_HEADER;
+    const uint16_t version = GAMECONTROLLER_STRUCT_VERSION;
+    unsigned char versionBytes[2];
+    memcpy(versionBytes, &version, sizeof(versionBytes)); // BPF loads are big endian
+
+    struct sock_filter code[] =
+    {
+      // [LEN]
+      BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, UDP_HEADER_SIZE + sizeof(RoboCupGameControlData), 0, REJECT - LEN - 2),
+      // [HEADER]
+      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, UDP_HEADER_SIZE + offsetof(RoboCupGameControlData, header)),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+               (unsigned) header[0] << 24 | header[1] << 16 | header[2] << 8 | header[3], 0, REJECT - HEADER - 2),
+      // [VERSION]
+      BPF_STMT(BPF_LD | BPF_H | BPF_ABS, UDP_HEADER_SIZE + offsetof(RoboCupGameControlData, version)),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (unsigned) versionBytes[0] << 8 | versionBytes[1], 0, REJECT - VERSION - 2),
+      // [TEAM0]
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, UDP_HEADER_SIZE + offsetof(RoboCupGameControlData, teams[0].teamNumber)),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (unsigned) teamNumber, ACCEPT - TEAM0 - 2, 0),
+      // [TEAM1]
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, UDP_HEADER_SIZE + offsetof(RoboCupGameControlData, teams[1].teamNumber)),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (unsigned) teamNumber, 0, REJECT - TEAM1 - 2),
+      // [ACCEPT]
+      BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+      // [REJECT]
+      BPF_STMT(BPF_RET | BPF_K, 0)
+    };
+
+    if(teamNumber)
+      return udp->setFilter(code, sizeof(code) / sizeof(code[0]));
+    else
+      return udp->setFilter(code + REJECT, 1); // Nothing is accepted without a team number
+  }
+
+  /**
+   * Receives a packet from the GameController.
+   * Packets are only accepted when the team number is know (nonzero) and
+   * they are addressed to this team. If the GameController sends the same
+   * packet through several interfaces, the first copy is accepted.
+   * Senders exceeding their packet rate are ignored and a single call handles
+   * at most MAX_PACKETS_PER_RECEIVE packets, so a flood cannot stall the caller.
+   */
+  bool receive()
+  {
+    bool received = false;
+    int size;
+    int interfaceIndex;
+    struct sockaddr_in from;
+    RoboCupGameControlData buffer;
+    int budget = MAX_PACKETS_PER_RECEIVE;
+    for(; transport && budget; --budget)
+    {
+      probe.begin(readStage);
+      if((size = transport->read((char*) &buffer, sizeof(buffer), &from, &interfaceIndex)) <= 0)
+        break;
+      probe.begin(validateStage);
+      const long long now = getMicroseconds();
+      Interface* interface = getInterface(interfaceIndex, !onlyListedInterfaces);
+      RateLimiter::Result admission = interface ? rateLimiter.admit(from.sin_addr.s_addr, now) : RateLimiter::accepted;
+      if(!interface)
+        ++drops.otherInterface;
+      else if(admission == RateLimiter::rateLimited)
+        ++drops.rateLimited;
+      else if(admission == RateLimiter::tableFull)
+        ++drops.tooManySenders;
+      else if(size != sizeof(buffer) || std::memcmp(&buffer, GAMECONTROLLER_STRUCT_HEADER, 4))
+        ++drops.malformed;
+      else if(buffer.version != GAMECONTROLLER_STRUCT_VERSION)
+        ++drops.wrongVersion;
+      else if(!teamNumber ||
+              (buffer.teams[0].teamNumber != teamNumber &&
+               buffer.teams[1].teamNumber != teamNumber))
+        ++drops.otherTeam;
+      else if(isDuplicate(buffer.packetNumber, now, *interface))
+        ++drops.duplicates;
+      else
+      {
+        accept(buffer, now);
+        received = true;
+      }
+    }
+    probe.end();
+    if(!budget && transport->wait(0)) // the last packet read may have emptied the queue
+      ++drops.budgetExhausted;
+    return received;
+  }
+
+  /**
+   * Makes a packet the current one.
+   * @param data The packet. It must have passed the checks of receive().
+   * @param now When it was received in µs of the monotonic clock.
+   */
+  void accept(const RoboCupGameControlData& data, long long now)
+  {
+    probe.begin(copyStage);
+    gameCtrlData = data;
+    whenPacketWasReceived = (unsigned) (now / 1000);
+    probe.begin(decodeStage);
+    decoded.decode(data, teamNumber, playerNumber ? *playerNumber : 0);
+    probe.begin(dispatchStage);
+    gameClock.update(data, teamNumber, playerNumber ? *playerNumber : 0, now);
+    history.add(data, now);
+    logShootout(shootout.update(data, teamNumber));
+  }
+
+  /**
+   * Continues from the state of a previous process (see HotRestart.h), so
+   * the game state is known before the next packet arrives.
+   * @param data The last packet the previous process accepted.
+   * @param whenReceived When it was received in µs of the monotonic clock.
+   * @param whenSent When the last return packet was sent in µs of the monotonic clock.
+   * @return Was the state restored? Only packets of the current team are.
+   */
+  bool restore(const RoboCupGameControlData& data, long long whenReceived, long long whenSent)
+  {
+    if(!teamNumber || std::memcmp(&data, GAMECONTROLLER_STRUCT_HEADER, 4) ||
+       data.version != GAMECONTROLLER_STRUCT_VERSION ||
+       (data.teams[0].teamNumber != teamNumber && data.teams[1].teamNumber != teamNumber))
+      return false;
+    accept(data, whenReceived);
+    probe.end();
+    whenPacketWasSent = (unsigned) (whenSent / 1000);
+
+    // A copy of the packet still queued is dropped as a duplicate.
+    recentPackets[nextRecentPacket].packetNumber = data.packetNumber;
+    recentPackets[nextRecentPacket].whenReceived = whenReceived;
+    nextRecentPacket = (nextRecentPacket + 1) % RECENT_PACKETS;
+    return true;
+  }
+
+
+  /**
+   * Logs the events of the penalty shootout caused by the last packet.
+   * @param numOfEvents The number of events.
+   */
+  void logShootout(int numOfEvents)
+  {
+    static const char* names[] = {"started", "attempt", "goal", "missed", "finished"};
+    for(int i = 0; i < numOfEvents; ++i)
+    {
+      const PenaltyShootout::Event& event = shootout.getEvent(i);
+      if(event.type == PenaltyShootout::Event::started || event.type == PenaltyShootout::Event::finished)
+        LOG("Penalty shootout %s", names[event.type]);
+      else
+        LOG("Penalty shootout: %s shot %d %s, score %d:%d", event.own ? "own" : "opponent", event.shot + 1,
+            names[event.type], shootout.getScore(true), shootout.getScore(false));
+    }
+  }
+
+  /**
+   * Waits until a packet arrives from the GameController.
+   * @param timeout The maximum time to wait in ms.
+   * @return Did a packet arrive? Its content is only checked by receive().
+   */
+  bool wait(int timeout)
+  {
+    if(transport)
+      return transport->wait(timeout);
+    usleep(timeout * 1000);
+    return false;
+  }
+
+  /**
+   * Replaces the transport packets are sent and received through, e.g. by a
+   * decorator of the socket for testing. The socket stays open and its
+   * configuration methods still apply to it.
+   * @param transport The new transport. 0 restores the socket.
+   */
+  void setTransport(Transport* transport)
+  {
+    this->transport = transport ? transport : udp;
+  }
+
+  /**
+   * Close all resources acquired.
+   * Called when initialization failed or during destruction.
+   */
+  void close()
+  {
+    if(udp)
+      delete udp;
+  }
+
+  //
+
+  /**
+   * The constructor sets up the structures required to communicate with NAOqi.
+   * @param socket A socket already bound to GAMECONTROLLER_PORT, e.g. one
+   *               handed over by a previous process. -1 opens a new one.
+   * @param teamNumber The team number. The socket filter for it is attached
+   *                   in one step, so an adopted socket never drops packets
+   *                   for this team. If it is 0, an adopted socket keeps its
+   *                   filter until setTeamNumber() is called.
+   */
+  GameCtrl(int socket = -1, int teamNumber = 0)
+  : udp(0),
+    transport(0),
+    playerNumber(0),
+    teamNumberPtr(0),
+    defaultTeamColour(0),
+    teamNumber(teamNumber),
+    onlyListedInterfaces(false),
+    rateLimiter(MAX_PACKET_RATE, MAX_PACKET_BURST)
+  {
+    memset(&drops, 0, sizeof(drops));
+    memset(interfaces, 0, sizeof(interfaces));
+    strncpy(broadcastAddress, UdpComm::getWifiBroadcastAddress(), sizeof(broadcastAddress) - 1);
+    broadcastAddress[sizeof(broadcastAddress) - 1] = 0;
+    init();
+
+    udp = socket != -1 ? new (std::nothrow) UdpComm(socket) : new (std::nothrow) UdpComm();
+    if(!udp ||
+       !udp->setBlocking(false) ||
+       !udp->setBroadcast(true) ||
+       (socket == -1 && !udp->bind("0.0.0.0", GAMECONTROLLER_PORT)) ||
+       !udp->setTarget(broadcastAddress, GAMECONTROLLER_PORT) ||
+       !udp->setPacketInfo(true) ||
+       !udp->setLoopback(false))
+      {
+        LOG("libgamectrl: Could not open UDP port");
+        delete udp;
+        udp = 0;
+        close();
+      }
+    else if(socket == -1 || teamNumber)
+      setFilter();
+    transport = udp;
+  }
+
+  /**
+   * Close all resources acquired.
+   */
+  ~GameCtrl()
+  {
+    close();
+  }
+};
+
+// GameCtrl.cpp instantiates the default league, so users of the library do not compile it again.
+extern template class GameCtrl<DefaultLeague>;
@@ -0,0 +1,187 @@
+/**
+ * @file GameCtrlApi.cpp
+ * Implements the C interface of libgamectrl on top of GameCtrl.
+ */
+
+#include "GameCtrlApi.h"
+#include <new>
+#include "GameCtrl.h"
+
+static const int MAX_CALLBACKS = 8; /**< The number of callbacks that can be registered per instance. */
+
+/** A registered callback. */
+struct Callback
+{
+  unsigned changes; /**< The changes it is called for. 0 if unused. */
+  gamectrl_callback function;
+  void* context;
+};
+
+/**
+ * The instance behind a handle. The packet of the previous update is kept
+ * to determine the changes.
+ */
+struct gamectrl
+{
+  GameCtrl<DefaultLeague> ctrl;
+  int playerNumber; /**< The player number GameCtrl points to. */
+  RoboCupGameControlData previous; /**< The packet before the last update. */
+  bool connected; /**< Was the GameController connected at the last update? */
+  Callback callbacks[MAX_CALLBACKS];
+};
+
+/**
+ * Determines what changed between two packets.
+ * @return A combination of GAMECTRL_CHANGED_* flags without GAMECTRL_CHANGED_PACKET.
+ */
+static unsigned compare(const RoboCupGameControlData& a, const RoboCupGameControlData& b)
+{
+  unsigned changes = 0;
+  if(a.state != b.state || a.secondaryState != b.secondaryState)
+    changes |= GAMECTRL_CHANGED_STATE;
+  if(a.kickOffTeam != b.kickOffTeam)
+    changes |= GAMECTRL_CHANGED_KICK_OFF;
+  for(int i = 0; i < 2; ++i)
+  {
+    if(a.teams[i].score != b.teams[i].score)
+      changes |= GAMECTRL_CHANGED_SCORE;
+    if(a.teams[i].teamNumber != b.teams[i].teamNumber || a.teams[i].teamColour != b.teams[i].teamColour)
+      changes |= GAMECTRL_CHANGED_TEAMS;
+  }
+  return changes;
+}
+
+int gamectrl_api_version(void)
+{
+  return GAMECTRL_API_VERSION;
+}
+
+gamectrl* gamectrl_create(int team_number, int player_number)
+{
+  // A failed allocation must not throw through the C caller.
+  gamectrl* handle = new (std::nothrow) gamectrl;
+  if(!handle)
+    return 0;
+  if(!handle->ctrl.udp)
+  {
+    delete handle;
+    return 0;
+  }
+  handle->playerNumber = player_number;
+  handle->ctrl.playerNumber = &handle->playerNumber;
+  handle->ctrl.setTeamNumber(team_number);
+  memset(&handle->previous, 0, sizeof(handle->previous));
+  handle->connected = false;
+  memset(handle->callbacks, 0, sizeof(handle->callbacks));
+  return handle;
+}
+
+void gamectrl_destroy(gamectrl* handle)
+{
+  delete handle;
+  Log::shutdown(); // A host may unload the library next.
+}
+
+void gamectrl_set_team(gamectrl* handle, int team_number)
+{
+  handle->ctrl.setTeamNumber(team_number);
+}
+
+void gamectrl_set_player(gamectrl* handle, int player_number)
+{
+  handle->playerNumber = player_number;
+  handle->ctrl.decoded.decode(handle->ctrl.gameCtrlData, handle->ctrl.teamNumber, player_number);
+}
+
+int gamectrl_add_interface(gamectrl* handle, const char* name)
+{
+  return handle->ctrl.addInterface(name);
+}
+
+int gamectrl_wait(gamectrl* handle, int timeout)
+{
+  return handle->ctrl.wait(timeout);
+}
+
+unsigned gamectrl_update(gamectrl* handle)
+{
+  GameCtrl<DefaultLeague>& ctrl = handle->ctrl;
+  const uint8_t penalty = ctrl.decoded.getPenalty();
+  unsigned changes = 0;
+  if(ctrl.receive())
+  {
+    changes = GAMECTRL_CHANGED_PACKET | compare(handle->previous, ctrl.gameCtrlData);
+    handle->previous = ctrl.gameCtrlData;
+  }
+  if(ctrl.decoded.getPenalty() != penalty)
+    changes |= GAMECTRL_CHANGED_PENALTY;
+  if(ctrl.updateLEDs())
+    changes |= GAMECTRL_CHANGED_LEDS;
+  if(gamectrl_is_connected(handle) != handle->connected)
+  {
+    handle->connected = !handle->connected;
+    changes |= GAMECTRL_CHANGED_CONNECTION;
+  }
+
+  const unsigned now = (unsigned) (getMicroseconds() / 1000);
+  if(ctrl.teamNumber && handle->playerNumber && now - ctrl.whenPacketWasSent >= (unsigned) ALIVE_DELAY)
+    ctrl.send(GAMECONTROLLER_RETURN_MSG_ALIVE);
+
+  if(changes)
+    for(const Callback& callback : handle->callbacks)
+      if(callback.changes & changes)
+        callback.function(&ctrl.gameCtrlData, changes, callback.context);
+  return changes;
+}
+
+const struct RoboCupGameControlData* gamectrl_get_data(const gamectrl* handle)
+{
+  return &handle->ctrl.gameCtrlData;
+}
+
+int gamectrl_is_connected(const gamectrl* handle)
+{
+  const unsigned now = (unsigned) (getMicroseconds() / 1000);
+  return handle->ctrl.whenPacketWasReceived && now - handle->ctrl.whenPacketWasReceived < (unsigned) GAMECONTROLLER_TIMEOUT;
+}
+
+int gamectrl_get_penalty(const gamectrl* handle)
+{
+  return handle->ctrl.decoded.getPenalty();
+}
+
+long long gamectrl_get_penalty_start(const gamectrl* handle)
+{
+  return handle->ctrl.getPenaltyStart();
+}
+
+void gamectrl_get_leds(const gamectrl* handle, unsigned* chest, unsigned* left_foot, unsigned* right_foot)
+{
+  *chest = handle->ctrl.leds.chest;
+  *left_foot = handle->ctrl.leds.leftFoot;
+  *right_foot = handle->ctrl.leds.rightFoot;
+}
+
+int gamectrl_send(gamectrl* handle, int message)
+{
+  return handle->ctrl.send((uint8_t) message);
+}
+
+int gamectrl_add_callback(gamectrl* handle, unsigned changes, gamectrl_callback callback, void* context)
+{
+  for(int i = 0; i < MAX_CALLBACKS; ++i)
+    if(!handle->callbacks[i].changes)
+    {
+      handle->callbacks[i].changes = changes ? changes : GAMECTRL_CHANGED_ALL;
+      handle->callbacks[i].function = callback;
+      handle->callbacks[i].context = context;
+      return i;
+    }
+  return -1;
+}
+
+void gamectrl_remove_callback(gamectrl* handle, int id)
+{
+  if(id >= 0 && id < MAX_CALLBACKS)
+    handle->callbacks[id].changes = 0;
+}
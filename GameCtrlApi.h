@@ -0,0 +1,136 @@
+/**
+ * @file GameCtrlApi.h
+ * The C interface of libgamectrl for embedding GameCtrl into robot
+ * frameworks. Only the functions declared here are exported by the shared
+ * library, so its ABI does not depend on the C++ classes behind it.
+ *
+ * All functions of a handle must be called from the same thread. The host
+ * calls gamectrl_wait() and gamectrl_update() in its loop, or only
+ * gamectrl_update() once per frame, since it does not block. Callbacks are
+ * called from gamectrl_update().
+ *
+ * The library is written in C++ and uses threads, so a C program links the
+ * C++ runtime and pthreads as well:
+ *   cc robot.o libgamectrl.a -lstdc++ -pthread
+ * libgamectrl.so already depends on both, so it only needs -lgamectrl.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "RoboCupGameControlData.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GAMECTRL_API_VERSION 1 /* increased with incompatible changes */
+
+/* The changes reported by gamectrl_update() and passed to callbacks. */
+#define GAMECTRL_CHANGED_PACKET     0x01 /* a packet was accepted */
+#define GAMECTRL_CHANGED_STATE      0x02 /* the state or the secondary state */
+#define GAMECTRL_CHANGED_SCORE      0x04 /* the score of a team */
+#define GAMECTRL_CHANGED_PENALTY    0x08 /* the penalty of this robot */
+#define GAMECTRL_CHANGED_KICK_OFF   0x10 /* the kick-off team */
+#define GAMECTRL_CHANGED_TEAMS      0x20 /* the team numbers or colours */
+#define GAMECTRL_CHANGED_LEDS       0x40 /* the colours of the LEDs */
+#define GAMECTRL_CHANGED_CONNECTION 0x80 /* the GameController appeared or vanished */
+#define GAMECTRL_CHANGED_ALL        0xff
+
+/* A GameCtrl instance. */
+typedef struct gamectrl gamectrl;
+
+/**
+ * A function called by gamectrl_update() when something changed.
+ * @param data The last packet accepted (see gamectrl_get_data()).
+ * @param changes A combination of GAMECTRL_CHANGED_* flags.
+ * @param context The pointer passed to gamectrl_add_callback().
+ */
+typedef void (*gamectrl_callback)(const struct RoboCupGameControlData* data, unsigned changes, void* context);
+
+/** Returns GAMECTRL_API_VERSION of the library. */
+int gamectrl_api_version(void);
+
+/**
+ * Creates an instance and opens the GameController port.
+ * @param team_number The number of our team. 0 if not known yet.
+ * @param player_number The number of this robot starting with 1. 0 if not known yet.
+ * @return The instance or NULL if the port could not be opened or memory
+ *         could not be allocated.
+ */
+gamectrl* gamectrl_create(int team_number, int player_number);
+
+/**
+ * Closes the port and frees an instance. Also writes the pending log
+ * messages and stops the thread of the logger until it is needed again, so
+ * the library can be unloaded afterwards.
+ */
+void gamectrl_destroy(gamectrl* handle);
+
+/** Sets the number of our team. Packets are only accepted while it is not 0. */
+void gamectrl_set_team(gamectrl* handle, int team_number);
+
+/** Sets the number of this robot starting with 1. */
+void gamectrl_set_player(gamectrl* handle, int player_number);
+
+/**
+ * Restricts reception to an interface. Can be called for several interfaces.
+ * @return 1 if the interface was found, 0 otherwise.
+ */
+int gamectrl_add_interface(gamectrl* handle, const char* name);
+
+/**
+ * Waits until a packet arrives.
+ * @param timeout The maximum time to wait in ms.
+ * @return 1 if a packet arrived, 0 otherwise.
+ */
+int gamectrl_wait(gamectrl* handle, int timeout);
+
+/**
+ * Reads the packets received, sends the alive signal when it is due and
+ * calls the callbacks whose changes occurred. Does not block.
+ * @return The changes, a combination of GAMECTRL_CHANGED_* flags.
+ */
+unsigned gamectrl_update(gamectrl* handle);
+
+/**
+ * Returns the last packet accepted without copying it. It is all zeros
+ * before the first packet. The structure is overwritten by
+ * gamectrl_update(), so it must not be used concurrently.
+ */
+const struct RoboCupGameControlData* gamectrl_get_data(const gamectrl* handle);
+
+/** Returns 1 if a packet was accepted within the last 2 s, 0 otherwise. */
+int gamectrl_is_connected(const gamectrl* handle);
+
+/** Returns the penalty of this robot or PENALTY_NONE. */
+int gamectrl_get_penalty(const gamectrl* handle);
+
+/** Returns when the current penalty of this robot started in µs of the monotonic clock or 0. */
+long long gamectrl_get_penalty_start(const gamectrl* handle);
+
+/** Returns the colours of the LEDs as specified in the rules as 0xRRGGBB. */
+void gamectrl_get_leds(const gamectrl* handle, unsigned* chest, unsigned* left_foot, unsigned* right_foot);
+
+/**
+ * Sends a return packet, e.g. a manual penalise request.
+ * @param message GAMECONTROLLER_RETURN_MSG_MAN_PENALISE, GAMECONTROLLER_RETURN_MSG_MAN_UNPENALISE or GAMECONTROLLER_RETURN_MSG_ALIVE.
+ * @return 1 if the packet was sent, 0 otherwise.
+ */
+int gamectrl_send(gamectrl* handle, int message);
+
+/**
+ * Registers a function called when changes occur.
+ * @param changes The GAMECTRL_CHANGED_* flags the function is interested in.
+ * @param callback The function.
+ * @param context A pointer passed to the function.
+ * @return An id for gamectrl_remove_callback() or -1 if too many are registered.
+ */
+int gamectrl_add_callback(gamectrl* handle, unsigned changes, gamectrl_callback callback, void* context);
+
+/** Unregisters a function registered with gamectrl_add_callback(). */
+void gamectrl_remove_callback(gamectrl* handle, int id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file GameStateHistory.cpp
+ * Implements a history of the game states received from the GameController.
+ */
+
+#include "GameStateHistory.h"
+
+static const long long RESTART_DELAY = 1000000; /**< A packet older than the newest one received after this many µs is from a restarted GameController. */
+
+GameStateHistory::GameStateHistory()
+: started(0),
+  completed(0)
+{}
+
+bool GameStateHistory::add(const RoboCupGameControlData& data, long long timestamp)
+{
+  const uint64_t n = completed.load(std::memory_order_relaxed);
+  uint64_t sequence = data.packetNumber;
+  if(n)
+  {
+    // Packet numbers wrap around after 255, so half of the range counts as newer.
+    const GameState& newest = getSlot(n - 1);
+    const uint8_t delta = (uint8_t) (data.packetNumber - newest.packetNumber);
+    if(!delta || (delta >= 128 && timestamp - newest.timestamp < RESTART_DELAY))
+      return false;
+    sequence = newest.sequence + delta;
+  }
+
+  started.store(n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  GameState& state = slots[n & (capacity - 1)];
+  state.sequence = sequence;
+  state.timestamp = timestamp;
+  state.packetNumber = data.packetNumber;
+  state.playersPerTeam = data.playersPerTeam;
+  state.gameType = data.gameType;
+  state.state = data.state;
+  state.firstHalf = data.firstHalf;
+  state.kickOffTeam = data.kickOffTeam;
+  state.secondaryState = data.secondaryState;
+  state.dropInTeam = data.dropInTeam;
+  state.dropInTime = data.dropInTime;
+  state.secsRemaining = data.secsRemaining;
+  state.secondaryTime = data.secondaryTime;
+  for(int i = 0; i < 2; ++i)
+  {
+    GameState::Team& team = state.teams[i];
+    team.teamNumber = data.teams[i].teamNumber;
+    team.teamColour = data.teams[i].teamColour;
+    team.score = data.teams[i].score;
+    team.penaltyShot = data.teams[i].penaltyShot;
+    team.singleShots = data.teams[i].singleShots;
+    for(int j = 0; j < MAX_NUM_PLAYERS; ++j)
+      team.players[j] = data.teams[i].players[j];
+  }
+  completed.store(n + 1, std::memory_order_release);
+  return true;
+}
+
+GameStateHistory::Snapshot GameStateHistory::getSnapshot() const
+{
+  const uint64_t end = completed.load(std::memory_order_acquire);
+  return Snapshot(this, end > capacity - margin ? end - (capacity - margin) : 0, end);
+}
+
+bool GameStateHistory::Snapshot::isValid() const
+{
+  // Writing version i overwrites version i - capacity.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return history->started.load(std::memory_order_relaxed) <= begin + capacity;
+}
+
+const GameState* GameStateHistory::Snapshot::findBySequence(uint64_t sequence) const
+{
+  uint64_t low = begin, high = end;
+  while(low < high)
+  {
+    const uint64_t middle = low + (high - low) / 2;
+    if(history->getSlot(middle).sequence < sequence)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low < end && history->getSlot(low).sequence == sequence ? &history->getSlot(low) : 0;
+}
+
+const GameState* GameStateHistory::Snapshot::findByTime(long long timestamp) const
+{
+  // Find the first version received after the time.
+  uint64_t low = begin, high = end;
+  while(low < high)
+  {
+    const uint64_t middle = low + (high - low) / 2;
+    if(history->getSlot(middle).timestamp <= timestamp)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low > begin ? &history->getSlot(low - 1) : 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file GameStateHistory.h
+ * Declares a history of the game states received from the GameController.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "RoboCupGameControlData.h"
+
+/**
+ * A compact version of a GameController packet without the header and the
+ * coach messages, stamped with when it was received.
+ */
+struct GameState
+{
+  /** The parts of TeamInfo kept. */
+  struct Team
+  {
+    uint8_t teamNumber;
+    uint8_t teamColour;
+    uint8_t score;
+    uint8_t penaltyShot;
+    uint16_t singleShots;
+    RobotInfo players[MAX_NUM_PLAYERS];
+  };
+
+  uint64_t sequence; /**< The packet number extended to 64 bits. Increases with every packet, gaps are lost packets. */
+  long long timestamp; /**< When the packet was received in µs of the monotonic clock. */
+  uint8_t packetNumber;
+  uint8_t playersPerTeam;
+  uint8_t gameType;
+  uint8_t state;
+  uint8_t firstHalf;
+  uint8_t kickOffTeam;
+  uint8_t secondaryState;
+  uint8_t dropInTeam;
+  uint16_t dropInTime;
+  uint16_t secsRemaining;
+  uint16_t secondaryTime;
+  Team teams[2];
+};
+
+/**
+ * @class GameStateHistory
+ * A ring of the last game states received. Versions are immutable once
+ * added; the ring reuses the slot of a version only after capacity newer
+ * ones were added.
+ *
+ * add() must be called from a single thread. Any thread can take a
+ * snapshot, which refers to the versions in the ring without copying them.
+ * A snapshot covers at most capacity - margin versions, so it stays valid
+ * for at least margin further packets. Readers that may be slower than that
+ * check isValid() after reading, like the readers of a sequence lock.
+ */
+class GameStateHistory
+{
+public:
+  enum {capacity = 256}; /**< The number of slots of the ring. A power of two. */
+  enum {margin = 16}; /**< The number of slots not visible in snapshots. */
+
+  /**
+   * The versions that were current when the snapshot was taken. Age 0 is
+   * the newest version.
+   */
+  class Snapshot
+  {
+  public:
+    /** The number of versions. */
+    size_t size() const {return (size_t) (end - begin);}
+
+    /** Returns a version by age. The age must be smaller than size(). */
+    const GameState& operator[](size_t age) const {return history->getSlot(end - 1 - age);}
+
+    /**
+     * Returns a version by its sequence number in O(log n).
+     * @return The version or 0 if it is not part of the snapshot, e.g. if the packet was lost.
+     */
+    const GameState* findBySequence(uint64_t sequence) const;
+
+    /**
+     * Returns the version that was current at a time in O(log n).
+     * @param timestamp The time in µs of the monotonic clock.
+     * @return The newest version received at or before that time or 0 if
+     *         the snapshot does not reach back that far.
+     */
+    const GameState* findByTime(long long timestamp) const;
+
+    /**
+     * Returns the oldest version of the newest run of versions that all
+     * satisfy a condition, e.g. when the current penalty started. Linear in
+     * the length of the run.
+     * @param condition A function that accepts (const GameState&) and returns bool.
+     * @return The version or 0 if the newest version does not satisfy the condition.
+     */
+    template<typename Condition> const GameState* since(Condition condition) const
+    {
+      const GameState* first = 0;
+      for(uint64_t i = end; i > begin && condition(history->getSlot(i - 1)); --i)
+        first = &history->getSlot(i - 1);
+      return first;
+    }
+
+    /** Were the versions referenced not yet overwritten? */
+    bool isValid() const;
+
+  private:
+    friend class GameStateHistory;
+
+    Snapshot(const GameStateHistory* history, uint64_t begin, uint64_t end) : history(history), begin(begin), end(end) {}
+
+    const GameStateHistory* history;
+    uint64_t begin; /**< The index of the oldest version. */
+    uint64_t end; /**< The index after the newest version. */
+  };
+
+  GameStateHistory();
+
+  /**
+   * Adds a packet. Duplicates and packets older than the newest version are
+   * ignored, unless the GameController seems to have been restarted.
+   * @param data The packet.
+   * @param timestamp When it was received in µs of the monotonic clock.
+   * @return Was a version added?
+   */
+  bool add(const RoboCupGameControlData& data, long long timestamp);
+
+  /** Returns the current versions. */
+  Snapshot getSnapshot() const;
+
+  /**
+   * Returns when the newest run of versions that all satisfy a condition
+   * started (see Snapshot::since()). Can be called from any thread.
+   * @param condition A function that accepts (const GameState&) and returns bool.
+   * @return The time stamp of the oldest version of the run in µs of the
+   *         monotonic clock. 0 if the newest version does not satisfy the
+   *         condition or if versions read were overwritten meanwhile.
+   */
+  template<typename Condition> long long getStartOf(Condition condition) const
+  {
+    const Snapshot snapshot = getSnapshot();
+    const GameState* first = snapshot.since(condition);
+    const long long timestamp = first ? first->timestamp : 0;
+    return snapshot.isValid() ? timestamp : 0;
+  }
+
+private:
+  const GameState& getSlot(uint64_t index) const {return slots[index & (capacity - 1)];}
+
+  GameState slots[capacity]; /**< The ring. Version i is in slot i % capacity. */
+  std::atomic<uint64_t> started; /**< The number of versions whose writing started. */
+  std::atomic<uint64_t> completed; /**< The number of versions completely written. */
+};
@@ -0,0 +1,246 @@
+/**
+ * @file HotRestart.cpp
+ * Implements the hand-over of GameCtrl from a running process to its successor.
+ */
+
+#include "HotRestart.h"
+#include "Log.h"
+#include "SystemTime.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define HOT_RESTART_HEADER  "GCHr"
+#define HOT_RESTART_VERSION 2
+
+static const int ACCEPT_INTERVAL = 100; /**< How often the background thread checks whether it should stop in ms. */
+
+/**
+ * Fills the address of the Unix socket. It is in the abstract namespace, so
+ * it disappears with the process and never has to be removed.
+ * @return The length of the address.
+ */
+static socklen_t getAddress(const char* name, struct sockaddr_un& address)
+{
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  const size_t length = strlen(name);
+  memcpy(address.sun_path + 1, name, length);
+  return (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + length);
+}
+
+HotRestart::HotRestart(int port)
+: segment(0),
+  socket(-1),
+  listener(-1),
+  handedOff(false),
+  stop(false)
+{
+  snprintf(name, sizeof(name), "/gamectrl-%d", port);
+
+  // The monotonic clock restarts at boot, so times saved before are meaningless.
+  memset(bootId, 0, sizeof(bootId));
+  FILE* file = fopen("/proc/sys/kernel/random/boot_id", "r");
+  if(!file || !fgets(bootId, sizeof(bootId), file))
+    LOG("HotRestart: Could not read the boot id");
+  if(file)
+    fclose(file);
+
+  const int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+  if(fd == -1 || ftruncate(fd, sizeof(Segment)) == -1 ||
+     (segment = (Segment*) mmap(0, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    LOG("HotRestart: Could not map shared memory %s: %s", name, strerror(errno));
+    segment = 0;
+  }
+  if(fd != -1)
+    close(fd);
+}
+
+HotRestart::~HotRestart()
+{
+  stop = true;
+  if(thread.joinable())
+    thread.join();
+  if(listener != -1)
+    close(listener);
+  if(segment)
+  {
+    munmap(segment, sizeof(Segment));
+    if(!handedOff)
+      shm_unlink(name);
+  }
+}
+
+int HotRestart::takeOver(int timeout)
+{
+  struct sockaddr_un address;
+  const socklen_t length = getAddress(name, address);
+  const int connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(connection == -1 || connect(connection, (struct sockaddr*) &address, length) == -1)
+  {
+    if(connection != -1)
+      close(connection);
+    return -1; // There is no predecessor.
+  }
+
+  int fd = -1;
+  struct pollfd p = {connection, POLLIN, 0};
+  char byte;
+  struct iovec iov = {&byte, 1};
+  char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  if(poll(&p, 1, timeout) == 1 && recvmsg(connection, &msg, 0) == 1)
+    for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+      if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+  if(fd == -1)
+    LOG("HotRestart: The predecessor did not hand over its socket");
+  close(connection);
+  return fd;
+}
+
+bool HotRestart::load(PersistedState& state, int maxAge) const
+{
+  if(!segment || memcmp(segment->header, HOT_RESTART_HEADER, sizeof(segment->header)) ||
+     segment->version != HOT_RESTART_VERSION)
+    return false;
+  const uint32_t sequence = segment->sequence.load(std::memory_order_acquire);
+  char savedBootId[BOOT_ID_SIZE];
+  memcpy(savedBootId, segment->bootId, sizeof(savedBootId));
+  state = segment->state;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  // If the predecessor crashed while writing, the state is incomplete.
+  if((sequence & 1) || segment->sequence.load(std::memory_order_relaxed) != sequence)
+    return false;
+
+  const long long age = getMicroseconds() - state.whenReceived;
+  if(!*bootId || memcmp(savedBootId, bootId, sizeof(bootId)))
+    LOG("HotRestart: Ignoring the state saved before the last boot");
+  else if(age < 0 || age > maxAge * 1000LL)
+    LOG("HotRestart: Ignoring the state saved %lld ms ago", age / 1000);
+  else
+    return true;
+  return false;
+}
+
+void HotRestart::save(const PersistedState& state)
+{
+  if(!segment)
+    return;
+  const uint32_t sequence = segment->sequence.load(std::memory_order_relaxed);
+  segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  segment->state = state;
+  memcpy(segment->bootId, bootId, sizeof(bootId));
+  memcpy(segment->header, HOT_RESTART_HEADER, sizeof(segment->header));
+  segment->version = HOT_RESTART_VERSION;
+  segment->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool HotRestart::openListener()
+{
+  struct sockaddr_un address;
+  const socklen_t length = getAddress(name, address);
+  listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listener == -1 || bind(listener, (struct sockaddr*) &address, length) == -1 || ::listen(listener, 1) == -1)
+  {
+    LOG("HotRestart: Could not listen for successors: %s", strerror(errno));
+    if(listener != -1)
+      close(listener);
+    listener = -1;
+    return false;
+  }
+  return true;
+}
+
+bool HotRestart::listen(int socket)
+{
+  if(!openListener())
+    return false;
+  this->socket = socket;
+  thread = std::thread(&HotRestart::serve, this);
+  return true;
+}
+
+void HotRestart::serve()
+{
+  while(!stop && listener != -1)
+  {
+    struct pollfd p = {listener, POLLIN, 0};
+    if(poll(&p, 1, ACCEPT_INTERVAL) != 1)
+      continue;
+    const int connection = accept(listener, 0, 0);
+    if(connection == -1)
+      continue;
+
+    // The abstract namespace has no permissions, so anybody could connect.
+    struct ucred peer;
+    socklen_t peerLength = sizeof(peer);
+    if(getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &peer, &peerLength) == -1 || peer.uid != getuid())
+    {
+      LOG("HotRestart: Refused to hand over the socket to a process of another user");
+      close(connection);
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Let the successor listen as soon as it has the socket.
+    close(listener);
+    listener = -1;
+
+    // The socket number of this process is pointed to an unbound socket, so
+    // this process cannot read packets meant for the successor anymore.
+    const int original = dup(socket);
+    const int dummy = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    const bool detached = original != -1 && dummy != -1 && dup2(dummy, socket) != -1;
+    if(dummy != -1)
+      close(dummy);
+
+    char byte = 0;
+    struct iovec iov = {&byte, 1};
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &original, sizeof(original));
+    if(detached && sendmsg(connection, &msg, MSG_NOSIGNAL) == 1)
+    {
+      LOG("HotRestart: Socket handed over");
+      handedOff = true;
+    }
+    else
+    {
+      // Keep running with the socket.
+      LOG("HotRestart: Could not hand over the socket: %s", strerror(errno));
+      if(detached)
+        dup2(original, socket);
+      openListener();
+    }
+    if(original != -1)
+      close(original);
+    close(connection);
+  }
+}
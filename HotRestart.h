@@ -0,0 +1,126 @@
+/**
+ * @file HotRestart.h
+ * Declares the hand-over of GameCtrl from a running process to its successor.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "RoboCupGameControlData.h"
+
+/** What a successor needs to continue where its predecessor stopped. */
+struct PersistedState
+{
+  RoboCupGameControlData data; /**< The last packet accepted. */
+  long long whenReceived; /**< When it was received in µs of the monotonic clock. */
+  long long whenSent; /**< When the last return packet was sent in µs of the monotonic clock. */
+  int teamNumber; /**< The team number it was accepted for. */
+  int playerNumber; /**< The player number of the robot. 0 if unknown. */
+};
+
+/**
+ * @class HotRestart
+ * Lets a new process take over from a running one, e.g. after an upgrade.
+ *
+ * The running process saves its state into a shared memory segment after
+ * every packet and serves a Unix socket in a background thread. A successor
+ * connects to it and receives the bound UDP socket with SCM_RIGHTS. Only
+ * processes of the same user get it. The
+ * predecessor stops reading the socket before passing it on, and the packets
+ * arriving meanwhile wait in the socket's queue, so none is lost. The state
+ * in shared memory is final when the socket arrives.
+ *
+ * If the predecessor crashed, there is nobody to hand over the socket, but
+ * the last state it saved is still there, so the successor does not have to
+ * wait for the next packet. The segment survives the crash, so a state is
+ * only loaded if it is recent and was saved since the last boot. It is
+ * removed when a process stops without handing over.
+ */
+class HotRestart
+{
+public:
+  /**
+   * Constructor.
+   * @param port The port of the socket handed over. It names the shared
+   *             memory segment and the Unix socket.
+   */
+  HotRestart(int port);
+
+  /**
+   * Stops serving successors. Unless the socket was handed over, the state
+   * saved is removed, because nobody continues from it.
+   */
+  ~HotRestart();
+
+  /**
+   * Takes over the socket of a running predecessor.
+   * @param timeout How long to wait for the socket in ms.
+   * @return The socket or -1 if no predecessor is running.
+   */
+  int takeOver(int timeout);
+
+  /**
+   * Reads the state saved by the predecessor.
+   * @param state The state is stored here.
+   * @param maxAge The maximum time since its packet was received in ms.
+   * @return Was a complete state found that was saved since the last boot
+   *         and is not older than maxAge?
+   */
+  bool load(PersistedState& state, int maxAge) const;
+
+  /**
+   * Saves the state for a successor. Must only be called by one thread and
+   * while the mutex is held.
+   */
+  void save(const PersistedState& state);
+
+  /**
+   * Starts serving successors in a background thread.
+   * @param socket The socket to hand over.
+   * @return Could the Unix socket be opened?
+   */
+  bool listen(int socket);
+
+  /**
+   * Was the socket handed over? Afterwards, the process cannot read from it
+   * anymore and should exit.
+   */
+  bool isHandedOff() const {return handedOff;}
+
+  /**
+   * Returns the mutex that must be held while the socket is read and the
+   * state is saved. The socket is handed over while nobody holds it.
+   */
+  std::mutex& getMutex() {return mutex;}
+
+private:
+  enum {BOOT_ID_SIZE = 37}; /**< The size of a boot id including the terminating zero. */
+
+  /** The layout of the shared memory segment. */
+  struct Segment
+  {
+    char header[4]; /**< HOT_RESTART_HEADER once initialised. */
+    uint32_t version; /**< The version of this layout. */
+    std::atomic<uint32_t> sequence; /**< Odd while state is written, like a sequence lock. */
+    char bootId[BOOT_ID_SIZE]; /**< The boot id of the kernel when the state was saved. */
+    PersistedState state;
+  };
+
+  /** Opens the Unix socket successors connect to. */
+  bool openListener();
+
+  /** Serves successors until one took over. */
+  void serve();
+
+  char name[32]; /**< The name of the shared memory segment and the Unix socket. */
+  char bootId[BOOT_ID_SIZE]; /**< The boot id of the running kernel. Empty if unknown. */
+  Segment* segment; /**< The shared memory. 0 if it could not be mapped. */
+  int socket; /**< The socket to hand over. */
+  int listener; /**< The Unix socket successors connect to. -1 if not listening. */
+  std::mutex mutex; /**< Held while the socket is read and the state is saved. */
+  std::atomic<bool> handedOff; /**< Was the socket handed over? */
+  std::atomic<bool> stop; /**< Should the background thread stop? */
+  std::thread thread; /**< Serves successors. */
+};
@@ -0,0 +1,162 @@
+/**
+ * @file ImpairedTransport.cpp
+ * Implements a transport decorator that emulates a bad network.
+ */
+
+#include "ImpairedTransport.h"
+#include "SystemTime.h"
+
+#include <cmath>
+
+static const int MAX_PACKET_SIZE = 65536; /**< The buffer size for packets read from the decorated transport. */
+
+ImpairedTransport::ImpairedTransport(Transport& transport, const Impairment& incoming, const Impairment& outgoing, unsigned seed)
+: transport(transport),
+  random(seed),
+  sequence(0),
+  buffer(MAX_PACKET_SIZE)
+{
+  this->incoming.impairment = incoming;
+  this->outgoing.impairment = outgoing;
+}
+
+long long ImpairedTransport::drawDelay(const Impairment& impairment)
+{
+  double delay = impairment.delay;
+  if(impairment.jitter)
+    switch(impairment.distribution)
+    {
+      case uniform:
+        delay += std::uniform_real_distribution<double>(-impairment.jitter, impairment.jitter)(random);
+        break;
+      case normal:
+        delay += std::normal_distribution<double>(0.0, impairment.jitter)(random);
+        break;
+      case pareto:
+      {
+        static const double alpha = 1.5; // infinite variance, i.e. occasional long stalls
+        const double u = std::uniform_real_distribution<double>(1e-9, 1.0)(random);
+        delay += impairment.jitter * (std::pow(u, -1.0 / alpha) - 1.0);
+        break;
+      }
+    }
+  return delay > 0.0 ? (long long) delay : 0;
+}
+
+void ImpairedTransport::impair(Direction& direction, const char* data, int len, const struct sockaddr_in* from,
+                               int interfaceIndex, long long now)
+{
+  std::uniform_real_distribution<float> chance(0.f, 1.f);
+  const Impairment& impairment = direction.impairment;
+  if(chance(random) < impairment.loss)
+  {
+    ++direction.counters.lost;
+    return;
+  }
+
+  const int copies = chance(random) < impairment.duplication ? 2 : 1;
+  direction.counters.duplicated += copies - 1;
+  for(int i = 0; i < copies; ++i)
+  {
+    if((int) direction.inFlight.size() >= impairment.limit)
+    {
+      ++direction.counters.overflowed;
+      continue;
+    }
+
+    // The emulated link sends one packet after the other.
+    long long sent = now;
+    if(impairment.bandwidth)
+    {
+      direction.linkFree = (direction.linkFree > now ? direction.linkFree : now)
+                           + (long long) len * 8 * 1000000 / impairment.bandwidth;
+      sent = direction.linkFree;
+    }
+
+    Packet packet;
+    packet.due = sent + drawDelay(impairment);
+    if(chance(random) < impairment.reordering)
+    {
+      packet.due += impairment.reorderDelay;
+      ++direction.counters.reordered;
+    }
+    packet.sequence = sequence++;
+    packet.data.assign(data, data + len);
+    if(from)
+      packet.from = *from;
+    else
+      memset(&packet.from, 0, sizeof(packet.from));
+    packet.interfaceIndex = interfaceIndex;
+    direction.inFlight.push(std::move(packet));
+  }
+}
+
+void ImpairedTransport::update()
+{
+  const long long now = getMicroseconds();
+
+  struct sockaddr_in from;
+  int interfaceIndex;
+  int size;
+  while((size = transport.read(buffer.data(), MAX_PACKET_SIZE, &from, &interfaceIndex)) >= 0)
+    impair(incoming, buffer.data(), size, &from, interfaceIndex, now);
+
+  while(!outgoing.inFlight.empty() && outgoing.inFlight.top().due <= now)
+  {
+    const Packet& packet = outgoing.inFlight.top();
+    transport.write(packet.data.data(), (int) packet.data.size());
+    ++outgoing.counters.passed;
+    outgoing.inFlight.pop();
+  }
+}
+
+bool ImpairedTransport::wait(int timeout)
+{
+  const long long start = getMicroseconds();
+  for(;;)
+  {
+    update();
+    const long long now = getMicroseconds();
+    if(!incoming.inFlight.empty() && incoming.inFlight.top().due <= now)
+      return true;
+
+    // Sleep until the next packet is due in either direction, new packets arrive or the time is up.
+    long long sleep = timeout < 0 ? -1 : start + timeout * 1000LL - now;
+    if(timeout >= 0 && sleep <= 0)
+      return false;
+    if(!incoming.inFlight.empty() && (sleep < 0 || incoming.inFlight.top().due - now < sleep))
+      sleep = incoming.inFlight.top().due - now;
+    if(!outgoing.inFlight.empty() && (sleep < 0 || outgoing.inFlight.top().due - now < sleep))
+      sleep = outgoing.inFlight.top().due - now;
+    transport.wait(sleep < 0 ? -1 : (int) ((sleep + 999) / 1000));
+  }
+}
+
+int ImpairedTransport::read(char* data, int len)
+{
+  return read(data, len, 0, 0);
+}
+
+int ImpairedTransport::read(char* data, int len, struct sockaddr_in* from, int* interfaceIndex)
+{
+  update();
+  if(incoming.inFlight.empty() || incoming.inFlight.top().due > getMicroseconds())
+    return -1;
+  const Packet& packet = incoming.inFlight.top();
+  const int size = (int) packet.data.size() < len ? (int) packet.data.size() : len;
+  memcpy(data, packet.data.data(), size);
+  if(from)
+    *from = packet.from;
+  if(interfaceIndex)
+    *interfaceIndex = packet.interfaceIndex;
+  ++incoming.counters.passed;
+  incoming.inFlight.pop();
+  return size;
+}
+
+bool ImpairedTransport::write(const char* data, const int len)
+{
+  impair(outgoing, data, len, 0, 0, getMicroseconds());
+  update();
+  return true;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file ImpairedTransport.h
+ * Declares a transport decorator that emulates a bad network.
+ */
+
+#pragma once
+
+#include "Transport.h"
+
+#include <queue>
+#include <random>
+#include <vector>
+
+/**
+ * @class ImpairedTransport
+ * Wraps another transport and impairs the packets passing through it in
+ * both directions: packets are lost, duplicated, delayed with jitter,
+ * reordered and limited in bandwidth. Incoming packets are held back until
+ * they are due. Outgoing packets are passed on by update(), which read(),
+ * write() and wait() call. All random decisions come from a seeded
+ * generator, so a run can be reproduced.
+ */
+class ImpairedTransport : public Transport
+{
+public:
+  /** The distribution of the delay around its mean. */
+  enum Distribution
+  {
+    uniform, /**< Uniform between delay - jitter and delay + jitter. */
+    normal, /**< Normal with mean delay and standard deviation jitter. */
+    pareto /**< At least delay with a heavy tail scaled by jitter, like wifi stalls. */
+  };
+
+  /** The impairment of one direction. */
+  struct Impairment
+  {
+    float loss = 0.f; /**< The probability that a packet is lost. */
+    float duplication = 0.f; /**< The probability that a packet is delivered twice. */
+    float reordering = 0.f; /**< The probability that a packet is held back by reorderDelay in addition. */
+    int delay = 0; /**< The mean delay in µs. */
+    int jitter = 0; /**< The spread of the delay in µs. */
+    Distribution distribution = uniform; /**< The distribution of the delay. */
+    int reorderDelay = 0; /**< The additional delay of reordered packets in µs. */
+    int bandwidth = 0; /**< The bandwidth in bits per second. 0 is unlimited. */
+    int limit = 1000; /**< The number of packets in flight. Packets beyond are dropped. */
+  };
+
+  /** What happened to the packets of one direction. */
+  struct Counters
+  {
+    unsigned passed = 0; /**< Packets that were passed on, including duplicates. */
+    unsigned lost = 0; /**< Packets dropped on purpose. */
+    unsigned duplicated = 0; /**< Packets delivered twice. */
+    unsigned reordered = 0; /**< Packets held back by reorderDelay. */
+    unsigned overflowed = 0; /**< Packets dropped, because too many were in flight. */
+  };
+
+  /**
+   * Constructor.
+   * @param transport The transport decorated. It must not block when reading.
+   * @param incoming The impairment of packets read.
+   * @param outgoing The impairment of packets written.
+   * @param seed The seed of the random generator.
+   */
+  ImpairedTransport(Transport& transport, const Impairment& incoming, const Impairment& outgoing, unsigned seed);
+
+  bool wait(int timeout) override;
+  int read(char* data, int len) override;
+  int read(char* data, int len, struct sockaddr_in* from, int* interfaceIndex) override;
+  bool write(const char* data, const int len) override;
+
+  /**
+   * Returns the error of the decorated transport. Packets are passed on
+   * later, so it belongs to the last packet passed on, not necessarily to
+   * the packet written last.
+   */
+  int getWriteError() const override {return transport.getWriteError();}
+
+  /**
+   * Moves incoming packets from the decorated transport to the delay queue
+   * and passes on the outgoing packets that are due.
+   */
+  void update();
+
+  const Counters& getIncomingCounters() const {return incoming.counters;}
+  const Counters& getOutgoingCounters() const {return outgoing.counters;}
+
+private:
+  /** A packet in flight. */
+  struct Packet
+  {
+    long long due; /**< When the packet is delivered in µs. */
+    unsigned sequence; /**< Keeps the order of packets due at the same time. */
+    std::vector<char> data; /**< The content. */
+    struct sockaddr_in from; /**< The sender of an incoming packet. */
+    int interfaceIndex; /**< The interface an incoming packet arrived on. */
+
+    bool operator<(const Packet& other) const
+    {
+      return due != other.due ? due > other.due : sequence > other.sequence; // earliest first
+    }
+  };
+
+  /** The state of one direction. */
+  struct Direction
+  {
+    Impairment impairment;
+    Counters counters;
+    std::priority_queue<Packet> inFlight; /**< The packets delayed. */
+    long long linkFree = 0; /**< When the emulated link has sent all packets in µs. */
+  };
+
+  /**
+   * Decides what happens to a packet and queues its copies.
+   */
+  void impair(Direction& direction, const char* data, int len, const struct sockaddr_in* from, int interfaceIndex, long long now);
+
+  /**
+   * Draws the delay of a packet in µs.
+   */
+  long long drawDelay(const Impairment& impairment);
+
+  Transport& transport; /**< The transport decorated. */
+  Direction incoming; /**< The impairment of packets read. */
+  Direction outgoing; /**< The impairment of packets written. */
+  std::mt19937 random; /**< The random generator. */
+  unsigned sequence; /**< The number of the next packet queued. */
+  std::vector<char> buffer; /**< Receives the packets from the decorated transport. */
+};
@@ -0,0 +1,117 @@
+/**
+ * @file League.h
+ * Declares the league policies GameCtrl is specialized with. Each policy
+ * maps the numbers of RoboCupGameControlData.h that differ between the
+ * leagues to constant tables, so interpreting them is a table load.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "RoboCupGameControlData.h"
+
+#define LED_OFF     0x000000
+#define LED_WHITE   0xffffff
+#define LED_RED     0xff0000
+#define LED_GREEN   0x00ff00
+#define LED_BLUE    0x0000ff
+#define LED_YELLOW  0xffff00
+#define LED_CYAN    0x00ffff
+#define LED_MAGENTA 0xff00ff
+
+/** The size of the penalty tables. Penalties are 4 bit values. */
+static constexpr int NUM_OF_PENALTIES = 16;
+
+/** The chest colours in the game states and when penalised, as specified in the rules. */
+static constexpr unsigned STATE_COLOURS[STATE_FINISHED + 1] = {LED_OFF, LED_BLUE, LED_YELLOW, LED_GREEN, LED_OFF};
+static constexpr unsigned PENALISED_COLOUR = LED_RED;
+
+/**
+ * Standard Platform League.
+ */
+struct SPL
+{
+  static constexpr const char* name = "SPL";
+  static constexpr const char* penaltyNames[NUM_OF_PENALTIES] =
+  {
+    "none",
+    "illegal ball contact",
+    "player pushing",
+    "illegal motion in set",
+    "inactive player",
+    "illegal defender",
+    "leaving the field",
+    "kick off goal",
+    "request for pickup",
+    "coach motion",
+    0, 0, 0, 0,
+    "substitute",
+    "manual"
+  };
+  static constexpr int numOfTeamColours = TEAM_BLACK + 1;
+  static constexpr unsigned teamColours[numOfTeamColours] = {LED_BLUE, LED_RED, LED_YELLOW, LED_OFF};
+};
+
+/**
+ * Humanoid League Kid Size.
+ */
+struct HLKid
+{
+  static constexpr const char* name = "HL Kid Size";
+  static constexpr const char* penaltyNames[NUM_OF_PENALTIES] =
+  {
+    "none",
+    "ball manipulation",
+    "physical contact",
+    "illegal attack",
+    "illegal defense",
+    "request for pickup",
+    "request for service",
+    "request for pickup to service",
+    0, 0, 0, 0, 0, 0,
+    "substitute",
+    "manual"
+  };
+  static constexpr int numOfTeamColours = TEAM_MAGENTA + 1;
+  static constexpr unsigned teamColours[numOfTeamColours] = {LED_CYAN, LED_MAGENTA};
+};
+
+/**
+ * Humanoid League Teen Size. The numbers are the same as in Kid Size.
+ */
+struct HLTeen : HLKid
+{
+  static constexpr const char* name = "HL Teen Size";
+};
+
+/**
+ * Returns the name of a penalty.
+ * @tparam League The league policy.
+ * @param penalty The penalty as sent by the GameController.
+ * @return The name or "unknown" for numbers not used in the league.
+ */
+template<typename League> const char* getPenaltyName(uint8_t penalty)
+{
+  const char* name = League::penaltyNames[penalty & (NUM_OF_PENALTIES - 1)];
+  return name ? name : "unknown";
+}
+
+/**
+ * Returns the LED colour of a team colour.
+ * @tparam League The league policy.
+ * @param teamColour The team colour as sent by the GameController.
+ * @return The colour as 0xRRGGBB. Unknown team colours are shown as off.
+ */
+template<typename League> unsigned getTeamColour(uint8_t teamColour)
+{
+  return teamColour < League::numOfTeamColours ? League::teamColours[teamColour] : LED_OFF;
+}
+
+/** The league the program is built for. Select it with -DLEAGUE_HL_KID or -DLEAGUE_HL_TEEN. */
+#if defined(LEAGUE_HL_KID)
+typedef HLKid DefaultLeague;
+#elif defined(LEAGUE_HL_TEEN)
+typedef HLTeen DefaultLeague;
+#else
+typedef SPL DefaultLeague;
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file LocalTransport.cpp
+ * Implements an in-process datagram transport.
+ */
+
+#include "LocalTransport.h"
+
+#include <chrono>
+
+LocalTransport::LocalTransport(int maxQueueLength)
+: peer(0),
+  maxQueueLength(maxQueueLength)
+{}
+
+void LocalTransport::connect(LocalTransport& a, LocalTransport& b)
+{
+  a.peer = &b;
+  b.peer = &a;
+}
+
+bool LocalTransport::wait(int timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if(timeout < 0)
+  {
+    available.wait(lock, [this] {return !queue.empty();});
+    return true;
+  }
+  else
+    return available.wait_for(lock, std::chrono::milliseconds(timeout), [this] {return !queue.empty();});
+}
+
+int LocalTransport::read(char* data, int len)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if(queue.empty())
+    return -1;
+  const std::vector<char>& packet = queue.front();
+  const int size = (int) packet.size() < len ? (int) packet.size() : len; // truncated like UDP
+  memcpy(data, packet.data(), size);
+  queue.pop_front();
+  return size;
+}
+
+bool LocalTransport::write(const char* data, const int len)
+{
+  if(!peer)
+    return false;
+  std::lock_guard<std::mutex> lock(peer->mutex);
+  if((int) peer->queue.size() >= peer->maxQueueLength)
+    return true; // dropped by the receiver like a full socket buffer would do
+  peer->queue.emplace_back(data, data + len);
+  peer->available.notify_one();
+  return true;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file LocalTransport.h
+ * Declares an in-process datagram transport.
+ */
+
+#pragma once
+
+#include "Transport.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class LocalTransport
+ * One endpoint of an in-process datagram link. Two endpoints are connected
+ * with connect() and each receives what the other writes. The endpoints may
+ * be used from different threads. Like a socket buffer, the queue of an
+ * endpoint is bounded and packets arriving at a full queue are dropped.
+ */
+class LocalTransport : public Transport
+{
+public:
+  /**
+   * Constructor.
+   * @param maxQueueLength The number of packets an endpoint buffers.
+   */
+  LocalTransport(int maxQueueLength = 256);
+
+  /**
+   * Connects two endpoints.
+   */
+  static void connect(LocalTransport& a, LocalTransport& b);
+
+  bool wait(int timeout) override;
+  int read(char* data, int len) override;
+  bool write(const char* data, const int len) override;
+
+private:
+  LocalTransport* peer; /**< The endpoint packets are written to. 0 if not connected. */
+  int maxQueueLength; /**< The capacity of the queue. */
+  std::mutex mutex; /**< Protects the queue. */
+  std::condition_variable available; /**< Signaled when a packet was queued. */
+  std::deque<std::vector<char>> queue; /**< The packets received but not read yet. */
+};
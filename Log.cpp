@@ -0,0 +1,404 @@
+/**
+ * @file Log.cpp
+ * Implements a logger that defers formatting.
+ */
+
+#include "Log.h"
+#include "SystemTime.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const unsigned RING_SIZE = 1 << 16; /**< The size of the ring buffer of each thread in bytes. */
+static const unsigned WAKE_THRESHOLD = RING_SIZE / 2; /**< A writer wakes up the background thread when its ring fills beyond this. */
+static const std::chrono::milliseconds FORMAT_INTERVAL(100); /**< How long the background thread sleeps between formatting. */
+
+/**
+ * The ring buffer of a thread. The thread writes, the background thread
+ * reads. When the thread has finished, the background thread deletes the
+ * ring after it has written its records.
+ */
+struct Ring
+{
+  std::atomic<unsigned> head{0}; /**< The number of bytes ever written. */
+  std::atomic<unsigned> tail{0}; /**< The number of bytes ever read. */
+  std::atomic<bool> finished{false}; /**< Has the thread finished? */
+  char buffer[RING_SIZE];
+
+  /** Copies data to a position in the ring buffer, wrapping around at the end. */
+  void put(unsigned position, const char* data, unsigned size)
+  {
+    const unsigned offset = position & (RING_SIZE - 1);
+    const unsigned first = size < RING_SIZE - offset ? size : RING_SIZE - offset;
+    memcpy(buffer + offset, data, first);
+    memcpy(buffer, data + first, size - first);
+  }
+
+  /** Copies data from a position in the ring buffer, wrapping around at the end. */
+  void get(unsigned position, char* data, unsigned size) const
+  {
+    const unsigned offset = position & (RING_SIZE - 1);
+    const unsigned first = size < RING_SIZE - offset ? size : RING_SIZE - offset;
+    memcpy(data, buffer + offset, first);
+    memcpy(data + first, buffer, size - first);
+  }
+};
+
+static thread_local Ring* threadRing = 0; /**< The ring of this thread. 0 until it logs. */
+
+/**
+ * Marks the ring of a thread as finished when the thread exits. A record
+ * logged afterwards, e.g. by another destructor, gets a new ring.
+ */
+struct RingOwner
+{
+  ~RingOwner()
+  {
+    threadRing->finished.store(true, std::memory_order_release);
+    threadRing = 0;
+  }
+};
+
+/** The shared state of the logger. */
+struct Logger
+{
+  std::mutex mutex; /**< Protects formats, rings and output. */
+  std::mutex wakeMutex; /**< Protects pending, stop and the changes of flushRequests. */
+  std::mutex threadMutex; /**< Protects starting and stopping the background thread. */
+  std::vector<const char*> formats; /**< The format strings registered. */
+  std::vector<Ring*> rings; /**< The ring buffers of all threads that logged. */
+  FILE* output = stderr; /**< Where the messages are written. */
+  std::thread thread; /**< The background thread. Not joinable if it is not running. */
+  std::atomic<unsigned> dropped{0}; /**< The number of records dropped. */
+  std::atomic<unsigned> flushRequests{0}; /**< Incremented to make the background thread run immediately. */
+  std::atomic<unsigned> flushed{0}; /**< The number of flush requests handled. */
+  bool pending = false; /**< Should the background thread run before its interval has passed? */
+  bool stop = false; /**< Should the background thread write all records and exit? */
+  std::atomic<unsigned long> timerSlack{0}; /**< The timer slack requested for the background thread in ns. 0 keeps the default. */
+  std::condition_variable wakeUp; /**< Signaled when pending or stop is set or a flush is requested. */
+  std::condition_variable done; /**< Signaled when a flush was handled. */
+};
+
+/** Returns the logger. It is intentionally leaked, so it outlives all static destructors. */
+static Logger& getLogger()
+{
+  static Logger* logger = new Logger;
+  return *logger;
+}
+
+/**
+ * Formats a record and writes it to a file. The arguments are matched to the
+ * conversions in the format string. The length modifiers are replaced by the
+ * ones of the types stored.
+ */
+static void format(FILE* file, const char* fmt, long long timestamp, const char* args, const char* end)
+{
+  fprintf(file, "[%lld.%06lld] ", timestamp / 1000000, timestamp % 1000000);
+  for(const char* p = fmt; *p; ++p)
+  {
+    if(*p != '%')
+    {
+      fputc(*p, file);
+      continue;
+    }
+    if(p[1] == '%')
+    {
+      fputc('%', file);
+      ++p;
+      continue;
+    }
+
+    // Copy flags, width and precision, skip the length modifiers.
+    char spec[32] = "%";
+    size_t length = 1;
+    for(++p; *p && strchr("-+ #0123456789.*", *p) && length < sizeof(spec) - 4; ++p)
+      spec[length++] = *p;
+    while(*p && strchr("hlLqjzt", *p))
+      ++p;
+    if(!*p)
+      break;
+    const char conversion = *p;
+
+    if(args >= end)
+    {
+      fputs("<missing>", file);
+      continue;
+    }
+    const char tag = *args++;
+    if(tag == 's')
+    {
+      const unsigned char size = (unsigned char) *args++;
+      char string[Log::maxStringLength + 1];
+      memcpy(string, args, size);
+      string[size] = 0;
+      args += size;
+      spec[length++] = 's';
+      spec[length] = 0;
+      fprintf(file, spec, string);
+      continue;
+    }
+
+    union
+    {
+      int64_t i;
+      uint64_t u;
+      double d;
+    } value;
+    memcpy(&value, args, sizeof(value));
+    args += sizeof(value);
+    if(strchr("eEfFgGaA", conversion))
+    {
+      spec[length++] = conversion;
+      spec[length] = 0;
+      fprintf(file, spec, tag == 'd' ? value.d : tag == 'i' ? (double) value.i : (double) value.u);
+    }
+    else if(conversion == 'p')
+      fprintf(file, "%p", (void*) (uintptr_t) value.u);
+    else if(conversion == 'c')
+    {
+      spec[length++] = 'c';
+      spec[length] = 0;
+      fprintf(file, spec, (int) value.i);
+    }
+    else
+    {
+      spec[length++] = 'l';
+      spec[length++] = 'l';
+      spec[length++] = strchr("diouxX", conversion) ? conversion : 'd';
+      spec[length] = 0;
+      fprintf(file, spec, tag == 'd' ? (long long) value.d : (long long) value.i);
+    }
+  }
+  fputc('\n', file);
+}
+
+/**
+ * Formats all records in the ring buffers and deletes the rings of the
+ * threads that have finished.
+ * @return Was there anything to format?
+ */
+static bool drain(Logger& logger)
+{
+  bool any = false;
+  std::lock_guard<std::mutex> lock(logger.mutex);
+  for(size_t i = 0; i < logger.rings.size();)
+  {
+    Ring* ring = logger.rings[i];
+    // The thread wrote its last record before it finished.
+    const bool finished = ring->finished.load(std::memory_order_acquire);
+    const unsigned head = ring->head.load(std::memory_order_acquire);
+    unsigned tail = ring->tail.load(std::memory_order_relaxed);
+    while(tail != head)
+    {
+      char record[Log::maxRecordSize];
+      uint16_t size, formatId;
+      long long timestamp;
+      ring->get(tail, record, 2);
+      memcpy(&size, record, sizeof(size));
+      ring->get(tail, record, size);
+      memcpy(&formatId, record + 2, sizeof(formatId));
+      memcpy(&timestamp, record + 4, sizeof(timestamp));
+      format(logger.output, logger.formats[formatId], timestamp, record + 12, record + size);
+      tail += size;
+      any = true;
+    }
+    ring->tail.store(tail, std::memory_order_release);
+    if(finished)
+    {
+      delete ring;
+      logger.rings[i] = logger.rings.back();
+      logger.rings.pop_back();
+    }
+    else
+      ++i;
+  }
+  if(any)
+    fflush(logger.output);
+  return any;
+}
+
+/** The background thread. */
+static void run()
+{
+  // Formatting can wait, so being woken up does not preempt the threads that log.
+  struct sched_param param = {0};
+  pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+
+  Logger& logger = getLogger();
+  unsigned handled = 0;
+  unsigned long timerSlack = 0;
+  for(bool stop = false; !stop;)
+  {
+    if(logger.timerSlack.load() != timerSlack)
+    {
+      timerSlack = logger.timerSlack.load();
+      prctl(PR_SET_TIMERSLACK, timerSlack);
+    }
+    unsigned requested;
+    {
+      std::lock_guard<std::mutex> lock(logger.wakeMutex);
+      requested = logger.flushRequests.load();
+      stop = logger.stop;
+    }
+    drain(logger);
+    if(requested != handled)
+    {
+      handled = requested;
+      std::lock_guard<std::mutex> lock(logger.mutex);
+      logger.flushed.store(handled);
+      logger.done.notify_all();
+    }
+    if(!stop)
+    {
+      // Writers do not wake up the thread for each record, so it looks for them regularly.
+      std::unique_lock<std::mutex> lock(logger.wakeMutex);
+      logger.wakeUp.wait_for(lock, FORMAT_INTERVAL,
+                             [&] {return logger.pending || logger.stop || logger.flushRequests.load() != handled;});
+      logger.pending = false;
+    }
+  }
+}
+
+/** Starts the background thread if it is not running. */
+static void start()
+{
+  Logger& logger = getLogger();
+  std::lock_guard<std::mutex> lock(logger.threadMutex);
+  if(!logger.thread.joinable())
+    logger.thread = std::thread(run);
+}
+
+/** Writes the remaining records when the program exits or the library is unloaded. */
+static struct Shutdown
+{
+  ~Shutdown() {Log::shutdown();}
+} shutdownOnExit;
+
+uint16_t Log::registerFormat(const char* format)
+{
+  start();
+  Logger& logger = getLogger();
+  std::lock_guard<std::mutex> lock(logger.mutex);
+  logger.formats.push_back(format);
+  return (uint16_t) (logger.formats.size() - 1);
+}
+
+void Log::setOutput(FILE* file)
+{
+  Logger& logger = getLogger();
+  std::lock_guard<std::mutex> lock(logger.mutex);
+  logger.output = file;
+}
+
+void Log::setTimerSlack(unsigned long slack)
+{
+  start();
+  Logger& logger = getLogger();
+  {
+    std::lock_guard<std::mutex> lock(logger.wakeMutex);
+    logger.timerSlack.store(slack);
+    logger.pending = true;
+  }
+  logger.wakeUp.notify_one();
+}
+
+void Log::flush()
+{
+  start();
+  Logger& logger = getLogger();
+  unsigned request;
+  {
+    std::lock_guard<std::mutex> lock(logger.wakeMutex);
+    request = logger.flushRequests.fetch_add(1) + 1;
+  }
+  logger.wakeUp.notify_all();
+  std::unique_lock<std::mutex> lock(logger.mutex);
+  logger.done.wait(lock, [&] {return (int) (logger.flushed.load() - request) >= 0;});
+}
+
+void Log::shutdown()
+{
+  Logger& logger = getLogger();
+  std::lock_guard<std::mutex> threadLock(logger.threadMutex);
+  if(!logger.thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(logger.wakeMutex);
+    logger.stop = true;
+  }
+  logger.wakeUp.notify_one();
+  logger.thread.join();
+  std::lock_guard<std::mutex> lock(logger.wakeMutex);
+  logger.stop = false;
+}
+
+unsigned Log::getNumOfDropped()
+{
+  return getLogger().dropped.load();
+}
+
+void Log::encode(char*& p, char* end, const char* value)
+{
+  if(!value)
+    value = "(null)";
+  size_t size = strlen(value);
+  if(size > maxStringLength)
+    size = maxStringLength;
+  if(end - p < (long) (2 + size))
+    return;
+  *p++ = 's';
+  *p++ = (char) size;
+  memcpy(p, value, size);
+  p += size;
+}
+
+void Log::commit(char* record, uint16_t formatId, int size)
+{
+  Ring* ring = threadRing;
+  if(!ring)
+  {
+    ring = threadRing = new Ring;
+    static thread_local RingOwner owner; // only constructed here, so it does not slow down the other calls
+    (void) owner;
+    Logger& logger = getLogger();
+    std::lock_guard<std::mutex> lock(logger.mutex);
+    logger.rings.push_back(ring);
+  }
+
+  const long long timestamp = getMicroseconds();
+  const uint16_t size16 = (uint16_t) size;
+  memcpy(record, &size16, sizeof(size16));
+  memcpy(record + 2, &formatId, sizeof(formatId));
+  memcpy(record + 4, &timestamp, sizeof(timestamp));
+
+  const unsigned head = ring->head.load(std::memory_order_relaxed);
+  const unsigned used = head - ring->tail.load(std::memory_order_acquire);
+  if(used + size > RING_SIZE)
+  {
+    getLogger().dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring->put(head, record, size);
+  ring->head.store(head + size, std::memory_order_release);
+
+  // The background thread finds the record within FORMAT_INTERVAL. It is
+  // only woken up by the record that fills the ring beyond the threshold.
+  if(used < WAKE_THRESHOLD && used + size >= WAKE_THRESHOLD)
+  {
+    start();
+    Logger& logger = getLogger();
+    {
+      std::lock_guard<std::mutex> lock(logger.wakeMutex);
+      logger.pending = true;
+    }
+    logger.wakeUp.notify_one();
+  }
+}
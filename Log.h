@@ -0,0 +1,139 @@
+/**
+ * @file Log.h
+ * Declares a logger that defers formatting. A call only stores the id of
+ * its format string, a time stamp and the raw arguments in a ring buffer
+ * of the calling thread. A background thread formats the records later. It
+ * looks for records every 100 ms, so logging does not wake it up, unless a
+ * ring buffer is half full or a flush is requested. The thread is started
+ * by the first use and stopped by shutdown() or when the program exits or
+ * the library is unloaded.
+ *
+ * Usage: LOG("UdpComm::bind() failed: %s", strerror(errno));
+ * A line break is appended to each message. Strings are copied (up to
+ * Log::maxStringLength characters), all other arguments are stored as
+ * 64 bit integers or doubles, so the length modifiers in the format
+ * string do not matter.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+/**
+ * Logs a message. The format string must be a literal, because it is
+ * registered once per call site.
+ */
+#define LOG(format, ...) \
+  do \
+  { \
+    static const uint16_t logFormatId = Log::registerFormat(format); \
+    Log::write(logFormatId, ##__VA_ARGS__); \
+  } \
+  while(false)
+
+/**
+ * @class Log
+ * The static interface of the logger.
+ */
+class Log
+{
+public:
+  enum {maxStringLength = 255}; /**< Longer string arguments are truncated. */
+  enum {maxRecordSize = 1024}; /**< Records that would be larger are truncated. */
+
+  /**
+   * Registers a format string.
+   * @param format The format string. It must stay valid forever.
+   * @return The id of the format.
+   */
+  static uint16_t registerFormat(const char* format);
+
+  /** Sets where the messages are written to. The default is stderr. */
+  static void setOutput(FILE* file);
+
+  /**
+   * Sets the timer slack of the background thread (see PR_SET_TIMERSLACK).
+   * It is applied when the thread wakes up the next time.
+   * @param slack The timer slack in ns.
+   */
+  static void setTimerSlack(unsigned long slack);
+
+  /**
+   * Formats all records logged so far. Blocks until they are written.
+   */
+  static void flush();
+
+  /**
+   * Writes all records logged so far and stops the background thread. It is
+   * started again when needed. This also happens when the program exits or
+   * the library is unloaded.
+   */
+  static void shutdown();
+
+  /**
+   * Returns the number of records dropped, because the ring buffer of their
+   * thread was full.
+   */
+  static unsigned getNumOfDropped();
+
+  /**
+   * Logs a record.
+   * @param formatId The id of the format string.
+   * @param args The arguments.
+   */
+  template<typename... Args> static void write(uint16_t formatId, const Args&... args)
+  {
+    char record[maxRecordSize];
+    char* p = record + headerSize;
+    [[maybe_unused]] char* const end = record + maxRecordSize;
+    int unused[] = {0, (encode(p, end, args), 0)...};
+    (void) unused;
+    commit(record, formatId, (int) (p - record));
+  }
+
+private:
+  enum {headerSize = 12}; /**< Size (2 bytes), format id (2 bytes) and time stamp (8 bytes). */
+
+  /** Stores an integral or enum argument. */
+  template<typename T> static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+  encode(char*& p, char* end, const T& value)
+  {
+    if(std::is_signed<T>::value)
+      encodeScalar(p, end, 'i', (int64_t) value);
+    else
+      encodeScalar(p, end, 'u', (uint64_t) value);
+  }
+
+  /** Stores a floating point argument. */
+  template<typename T> static typename std::enable_if<std::is_floating_point<T>::value>::type
+  encode(char*& p, char* end, const T& value)
+  {
+    encodeScalar(p, end, 'd', (double) value);
+  }
+
+  /** Stores a string argument. */
+  static void encode(char*& p, char* end, const char* value);
+  static void encode(char*& p, char* end, char* value) {encode(p, end, (const char*) value);}
+
+  /** Stores a pointer argument. */
+  static void encode(char*& p, char* end, const void* value) {encodeScalar(p, end, 'p', (uint64_t) (uintptr_t) value);}
+
+  /** Stores a type tag and a scalar value. */
+  template<typename T> static void encodeScalar(char*& p, char* end, char tag, T value)
+  {
+    if(end - p >= (int) (1 + sizeof(value)))
+    {
+      *p++ = tag;
+      memcpy(p, &value, sizeof(value));
+      p += sizeof(value);
+    }
+  }
+
+  /**
+   * Adds the header and copies a record into the ring buffer of this thread.
+   */
+  static void commit(char* record, uint16_t formatId, int size);
+};
@@ -0,0 +1,197 @@
+/**
+ * @file Main.cpp
+ * A command line program that runs GameCtrl and logs what it receives.
+ *
+ * Usage: a.out [--low-latency | --low-power] [--interface <name>]... [--player <number>]
+ *              [--clock-sync | --clock-host] [--log <file>] [--hot-restart]
+ *
+ * With --hot-restart, a new instance started with the same option takes
+ * over the socket and the game state of the running one, which then exits.
+ * SIGINT and SIGTERM stop the program cleanly, so no state is left behind.
+ * Sockets bound in advance by a service manager (systemd socket activation)
+ * are used instead of opening new ones.
+ * With --low-power, the process wakes up as rarely as the game allows (see
+ * PowerSaver.h) and reports its wakeups and CPU usage every minute.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include "GameCtrl.h"
+#include "ClockSync.h"
+#include "MatchLog.h"
+#include "HotRestart.h"
+#include "PowerSaver.h"
+
+static const int MATCH_LOG_BLOCK = 120; /**< Packets per block of the match log, i.e. about a minute. */
+static const int HANDOVER_TIMEOUT = 1000; /**< How long to wait for the socket of a running instance in ms. */
+static const int CLOCK_SYNC_RESPONSE_TIMEOUT = 20; /**< How long to wait for a clock sync response in low power mode in ms. */
+
+static volatile sig_atomic_t stopRequested = 0; /**< Was the program asked to stop? */
+
+/** Makes the main loop stop. */
+static void requestStop(int)
+{
+  stopRequested = 1;
+}
+
+/**
+ * Opens the socket used for clock synchronization.
+ * @return The socket or 0 if it could not be opened.
+ */
+static UdpComm* openClockSyncSocket()
+{
+  const int socket = UdpComm::getActivatedSocket(CLOCK_SYNC_PORT);
+  UdpComm* udp = socket != -1 ? new UdpComm(socket) : new UdpComm();
+  if(!udp->setBlocking(false) ||
+     !udp->setBroadcast(true) ||
+     (socket == -1 && !udp->bind("0.0.0.0", CLOCK_SYNC_PORT)) ||
+     !udp->setTarget(UdpComm::getWifiBroadcastAddress(), CLOCK_SYNC_PORT))
+  {
+    LOG("libgamectrl: Could not open clock sync port");
+    delete udp;
+    udp = 0;
+  }
+  return udp;
+}
+
+int main(int argc, char *argv[])
+{
+  const long long start = getMicroseconds();
+
+  // A running instance hands over its socket before this one would open another.
+  HotRestart* hotRestart = 0;
+  int socket = -1;
+  for(int i = 1; i < argc; ++i)
+    if(!strcmp(argv[i], "--hot-restart") && !hotRestart)
+    {
+      hotRestart = new HotRestart(GAMECONTROLLER_PORT);
+      socket = hotRestart->takeOver(HANDOVER_TIMEOUT);
+    }
+
+  if(socket == -1)
+    socket = UdpComm::getActivatedSocket(GAMECONTROLLER_PORT);
+
+  GameCtrl<DefaultLeague> gamectl(socket, 2);
+  static int player = 0;
+  UdpComm* clockSyncUdp = 0;
+  ClockSync* clockSync = 0;
+  ClockSyncServer* clockSyncServer = 0;
+  bool clockSyncRequested = false;
+  MatchLogWriter* matchLog = 0;
+  PowerSaver* powerSaver = 0;
+  for(int i = 1; i < argc; ++i)
+    if(!strcmp(argv[i], "--low-latency") && gamectl.udp && !powerSaver)
+      gamectl.udp->setLowLatency(50);
+    else if(!strcmp(argv[i], "--low-power") && !powerSaver)
+      powerSaver = new PowerSaver();
+    else if(!strcmp(argv[i], "--interface") && i + 1 < argc)
+      gamectl.addInterface(argv[++i]);
+    else if(!strcmp(argv[i], "--player") && i + 1 < argc)
+    {
+      player = atoi(argv[++i]);
+      gamectl.playerNumber = &player;
+    }
+    else if(!strcmp(argv[i], "--clock-sync") && !clockSyncServer)
+      clockSyncRequested = true; // created below, when the player number is known
+    else if(!strcmp(argv[i], "--clock-host") && !clockSyncRequested && !clockSyncUdp &&
+            (clockSyncUdp = openClockSyncSocket()))
+      clockSyncServer = new ClockSyncServer(*clockSyncUdp);
+    else if(!strcmp(argv[i], "--log") && i + 1 < argc && !matchLog)
+      matchLog = new MatchLogWriter(argv[++i], MATCH_LOG_BLOCK); // only complete blocks survive a kill
+
+  if(hotRestart)
+  {
+    PersistedState state;
+    if(hotRestart->load(state, GAMECONTROLLER_TIMEOUT))
+    {
+      if(!gamectl.playerNumber && state.playerNumber)
+      {
+        player = state.playerNumber;
+        gamectl.playerNumber = &player;
+      }
+      if(gamectl.restore(state.data, state.whenReceived, state.whenSent))
+        LOG("Restored state %d of packet %d", state.data.state, state.data.packetNumber);
+    }
+    if(gamectl.udp)
+      hotRestart->listen(gamectl.udp->getSocket());
+  }
+
+  if(clockSyncRequested && (clockSyncUdp = openClockSyncSocket()))
+    clockSync = new ClockSync(*clockSyncUdp, (uint8_t) gamectl.teamNumber, (uint8_t) player);
+
+  // Without SA_RESTART, the signals also interrupt waiting for packets.
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = requestStop;
+  sigaction(SIGINT, &action, 0);
+  sigaction(SIGTERM, &action, 0);
+
+  LOG("Ready, setup took %lld us", getMicroseconds() - start);
+  while(!stopRequested && (!hotRestart || !hotRestart->isHandedOff())){
+    if(!powerSaver)
+    {
+      gamectl.wait(clockSync || clockSyncServer ? 10 : ALIVE_DELAY);
+      if(clockSync)
+        clockSync->update();
+      if(clockSyncServer)
+        clockSyncServer->update();
+    }
+    else if(powerSaver->wait(gamectl.transport))
+    {
+      // All periodic work is done at ticks.
+      gamectl.updateBroadcastAddress();
+      const unsigned now = (unsigned) (getMicroseconds() / 1000);
+      if(gamectl.playerNumber && gamectl.whenPacketWasReceived &&
+         now - gamectl.whenPacketWasReceived < (unsigned) GAMECONTROLLER_TIMEOUT)
+        gamectl.send(GAMECONTROLLER_RETURN_MSG_ALIVE);
+      if(clockSync)
+      {
+        // The response is read as soon as it arrives, because the delay would count as round trip.
+        clockSync->update();
+        if(clockSyncUdp->wait(CLOCK_SYNC_RESPONSE_TIMEOUT))
+          clockSync->update();
+      }
+      if(clockSyncServer)
+        clockSyncServer->update();
+      PowerSaver::Report report;
+      if(powerSaver->getReport(report))
+        LOG("Power: %.1f wakeups/s (%.1f of the loop), %.1f context switches/s, %.2f%% CPU, period %d ms",
+            report.wakeupsPerSecond, report.loopWakeupsPerSecond, report.contextSwitchesPerSecond,
+            report.residency * 100.0, powerSaver->getPeriod());
+    }
+    std::unique_lock<std::mutex> lock;
+    if(hotRestart)
+      lock = std::unique_lock<std::mutex>(hotRestart->getMutex());
+    if(gamectl.receive()){
+      if(hotRestart)
+      {
+        PersistedState state;
+        state.data = gamectl.gameCtrlData;
+        state.whenReceived = gamectl.whenPacketWasReceived * 1000LL;
+        state.whenSent = gamectl.whenPacketWasSent * 1000LL;
+        state.teamNumber = gamectl.teamNumber;
+        state.playerNumber = player;
+        hotRestart->save(state);
+      }
+      if(matchLog)
+        matchLog->write(gamectl.gameCtrlData, gamectl.whenPacketWasReceived * 1000LL);
+      if(gamectl.updateLEDs())
+        LOG("%s chest %06x left %06x right %06x penalty %s", DefaultLeague::name, gamectl.leds.chest,
+               gamectl.leds.leftFoot, gamectl.leds.rightFoot, gamectl.getPenaltyName());
+      if(clockSync && clockSync->isSynchronized())
+        LOG("%d %lld", gamectl.gameCtrlData.state,
+               clockSync->toHostTime(gamectl.whenPacketWasReceived * 1000LL) / 1000);
+      else
+        LOG("%d", gamectl.gameCtrlData.state);
+    }
+    if(powerSaver)
+      powerSaver->update(gamectl.gameCtrlData.state, gamectl.whenPacketWasReceived &&
+                         (unsigned) (getMicroseconds() / 1000) - gamectl.whenPacketWasReceived < (unsigned) GAMECONTROLLER_TIMEOUT);
+  }
+  delete powerSaver;
+  delete matchLog;
+  delete hotRestart;
+  Log::flush();
+  return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file MatchColumns.cpp
+ * Implements the columnar layout of match logs.
+ */
+
+#include "MatchColumns.h"
+
+#include <errno.h>
+#include <fnmatch.h>
+#include <string.h>
+#include "Log.h"
+
+void MatchColumns::add(MatchLogReader& reader)
+{
+  MatchLogEntry entry;
+  while(reader.read(entry))
+    add(entry);
+}
+
+void MatchColumns::add(const MatchLogEntry& entry)
+{
+  if(entry.type == MatchLogEntry::gameControlData)
+  {
+    const RoboCupGameControlData& data = entry.gameControl;
+    timestamp.push_back(entry.timestamp);
+    packetNumber.push_back(data.packetNumber);
+    playersPerTeam.push_back(data.playersPerTeam);
+    gameType.push_back(data.gameType);
+    state.push_back(data.state);
+    firstHalf.push_back(data.firstHalf);
+    kickOffTeam.push_back(data.kickOffTeam);
+    secondaryState.push_back(data.secondaryState);
+    dropInTeam.push_back(data.dropInTeam);
+    dropInTime.push_back(data.dropInTime);
+    secsRemaining.push_back(data.secsRemaining);
+    secondaryTime.push_back(data.secondaryTime);
+    for(int t = 0; t < 2; ++t)
+    {
+      const TeamInfo& team = data.teams[t];
+      teamNumber[t].push_back(team.teamNumber);
+      teamColour[t].push_back(team.teamColour);
+      score[t].push_back(team.score);
+      penaltyShot[t].push_back(team.penaltyShot);
+      singleShots[t].push_back(team.singleShots);
+      coachSequence[t].push_back(team.coachSequence);
+      for(int p = 0; p < MAX_NUM_PLAYERS; ++p)
+      {
+        penalty[t][p].push_back(team.players[p].penalty);
+        secsTillUnpenalised[t][p].push_back(team.players[p].secsTillUnpenalised);
+      }
+    }
+  }
+  else
+  {
+    // Messages are stored as received, so fields beyond their size keep their defaults.
+    SPLStandardMessage message;
+    memcpy(&message, entry.data, entry.size);
+    messageTimestamp.push_back(entry.timestamp);
+    teamNum.push_back(message.teamNum);
+    playerNum.push_back(message.playerNum);
+    fallen.push_back(message.fallen);
+    poseX.push_back(message.pose[0]);
+    poseY.push_back(message.pose[1]);
+    poseTheta.push_back(message.pose[2]);
+    ballAge.push_back(message.ballAge);
+    ballX.push_back(message.ball[0]);
+    ballY.push_back(message.ball[1]);
+    intention.push_back(message.intention);
+  }
+}
+
+bool MatchColumns::save(const char* path)
+{
+  FILE* file = fopen(path, "wb");
+  if(!file)
+  {
+    LOG("MatchColumns::save(): cannot open %s: %s", path, strerror(errno));
+    return false;
+  }
+  uint32_t numOfColumns = 0;
+  forEachColumn([&](const char*, const auto&) {++numOfColumns;});
+  bool ok = fwrite(MATCH_COLUMNS_HEADER, 4, 1, file) == 1 && fputc(MATCH_COLUMNS_VERSION, file) != EOF &&
+            fwrite(&numOfColumns, sizeof(numOfColumns), 1, file) == 1;
+  forEachColumn([&](const char* name, const auto& column)
+  {
+    const unsigned char nameLength = (unsigned char) strlen(name);
+    const unsigned char elementSize = (unsigned char) sizeof(column[0]);
+    const uint32_t size = (uint32_t) column.size();
+    ok = ok && fputc(nameLength, file) != EOF && fwrite(name, nameLength, 1, file) == 1 &&
+         fputc(elementSize, file) != EOF && fwrite(&size, sizeof(size), 1, file) == 1 &&
+         (!size || fwrite(column.data(), elementSize, size, file) == size);
+  });
+  if(fclose(file) || !ok)
+  {
+    LOG("MatchColumns::save(): cannot write %s", path);
+    return false;
+  }
+  return true;
+}
+
+bool MatchColumns::load(const char* path, const char* const* patterns)
+{
+  FILE* file = fopen(path, "rb");
+  if(!file)
+  {
+    LOG("MatchColumns::load(): cannot open %s: %s", path, strerror(errno));
+    return false;
+  }
+  char header[5];
+  uint32_t numOfColumns = 0, expected = 0;
+  forEachColumn([&](const char*, const auto&) {++expected;});
+  bool ok = fread(header, sizeof(header), 1, file) == 1 && !memcmp(header, MATCH_COLUMNS_HEADER, 4) &&
+            header[4] == MATCH_COLUMNS_VERSION && fread(&numOfColumns, sizeof(numOfColumns), 1, file) == 1 &&
+            numOfColumns == expected;
+
+  // The columns must appear in the order of forEachColumn().
+  forEachColumn([&](const char* name, auto& column)
+  {
+    char storedName[256];
+    int nameLength = 0, elementSize = 0;
+    uint32_t size = 0;
+    ok = ok && (nameLength = fgetc(file)) != EOF && fread(storedName, 1, nameLength, file) == (size_t) nameLength &&
+         nameLength == (int) strlen(name) && !memcmp(storedName, name, nameLength) &&
+         (elementSize = fgetc(file)) == (int) sizeof(column[0]) && fread(&size, sizeof(size), 1, file) == 1;
+    if(!ok)
+      return;
+    bool selected = !patterns;
+    for(const char* const* pattern = patterns; pattern && *pattern && !selected; ++pattern)
+      selected = !fnmatch(*pattern, name, 0);
+    if(!selected)
+      ok = !fseek(file, (long) elementSize * size, SEEK_CUR);
+    else
+    {
+      const size_t offset = column.size();
+      column.resize(offset + size);
+      ok = !size || fread(column.data() + offset, elementSize, size, file) == size;
+    }
+  });
+  fclose(file);
+  if(!ok)
+    LOG("MatchColumns::load(): %s is not a column file of version %d", path, MATCH_COLUMNS_VERSION);
+  return ok;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file MatchColumns.h
+ * Declares a columnar layout of match logs for analyses over many matches.
+ * Each field of the packets is stored in its own array, so a query only
+ * reads the fields it needs and scans them sequentially.
+ *
+ * File format: "RMCl", version (1 byte), number of columns (4 bytes), then
+ * per column: length of name (1 byte), name, size of an element (1 byte),
+ * number of elements (4 bytes), elements.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "RoboCupGameControlData.h"
+#include "MatchLog.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define MATCH_COLUMNS_HEADER  "RMCl"
+#define MATCH_COLUMNS_VERSION 1
+
+/**
+ * The packets of a match, one array per field. The GameController columns
+ * have one element per GameController packet, the message columns one per
+ * team message. The header, the version and the coach messages are not
+ * stored.
+ */
+struct MatchColumns
+{
+  /** @name GameController packets */
+  /** @{ */
+  std::vector<int64_t> timestamp; /**< When the packet was received in µs. */
+  std::vector<uint8_t> packetNumber;
+  std::vector<uint8_t> playersPerTeam;
+  std::vector<uint8_t> gameType;
+  std::vector<uint8_t> state;
+  std::vector<uint8_t> firstHalf;
+  std::vector<uint8_t> kickOffTeam;
+  std::vector<uint8_t> secondaryState;
+  std::vector<uint8_t> dropInTeam;
+  std::vector<uint16_t> dropInTime;
+  std::vector<uint16_t> secsRemaining;
+  std::vector<uint16_t> secondaryTime;
+  std::vector<uint8_t> teamNumber[2];
+  std::vector<uint8_t> teamColour[2];
+  std::vector<uint8_t> score[2];
+  std::vector<uint8_t> penaltyShot[2];
+  std::vector<uint16_t> singleShots[2];
+  std::vector<uint8_t> coachSequence[2];
+  std::vector<uint8_t> penalty[2][MAX_NUM_PLAYERS];
+  std::vector<uint8_t> secsTillUnpenalised[2][MAX_NUM_PLAYERS];
+  /** @} */
+
+  /** @name Team messages */
+  /** @{ */
+  std::vector<int64_t> messageTimestamp; /**< When the message was received in µs. */
+  std::vector<int8_t> teamNum;
+  std::vector<int8_t> playerNum;
+  std::vector<int8_t> fallen;
+  std::vector<float> poseX;
+  std::vector<float> poseY;
+  std::vector<float> poseTheta;
+  std::vector<float> ballAge;
+  std::vector<float> ballX;
+  std::vector<float> ballY;
+  std::vector<int8_t> intention;
+  /** @} */
+
+  /**
+   * Appends all packets of a match log.
+   * @param reader The match log.
+   */
+  void add(MatchLogReader& reader);
+
+  /** Appends a packet. */
+  void add(const MatchLogEntry& entry);
+
+  /**
+   * Writes the columns to a file.
+   * @return Was the file written?
+   */
+  bool save(const char* path);
+
+  /**
+   * Reads the columns from a file written by save(). Columns already loaded
+   * are extended.
+   * @param path The file.
+   * @param patterns If not 0, only the columns whose names match one of
+   *                 these patterns are read, the others are skipped. A
+   *                 pattern is a name in which * and ? are wildcards as in
+   *                 the shell, e.g. "team?.player*.penalty". The array ends
+   *                 with 0.
+   * @return Was the file read completely?
+   */
+  bool load(const char* path, const char* const* patterns = 0);
+
+  /**
+   * Calls a function with the name and the array of each column.
+   * @param f A function that accepts (const char* name, std::vector<T>& column).
+   */
+  template<typename F> void forEachColumn(F f);
+};
+
+/**
+ * Calls a function for each element of a column that differs from its
+ * predecessor. With SSE2, 16 elements are compared at once and only the
+ * chunks that contain changes are looked at individually.
+ * @param column The column.
+ * @param size The number of elements.
+ * @param f A function that accepts (size_t index, uint8_t value).
+ */
+template<typename F> void forEachChange(const uint8_t* column, size_t size, F f)
+{
+  size_t i = 1;
+#ifdef __SSE2__
+  for(; i + 16 <= size; i += 16)
+  {
+    const __m128i current = _mm_loadu_si128((const __m128i*) (column + i));
+    const __m128i previous = _mm_loadu_si128((const __m128i*) (column + i - 1));
+    for(unsigned mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(current, previous)) & 0xffff; mask; mask &= mask - 1)
+    {
+      const size_t index = i + __builtin_ctz(mask);
+      f(index, column[index]);
+    }
+  }
+#endif
+  for(; i < size; ++i)
+    if(column[i] != column[i - 1])
+      f(i, column[i]);
+}
+
+template<typename F> void MatchColumns::forEachColumn(F f)
+{
+  static const char* teamNames[2] = {"team0.", "team1."};
+  char name[64];
+
+  f("timestamp", timestamp);
+  f("packetNumber", packetNumber);
+  f("playersPerTeam", playersPerTeam);
+  f("gameType", gameType);
+  f("state", state);
+  f("firstHalf", firstHalf);
+  f("kickOffTeam", kickOffTeam);
+  f("secondaryState", secondaryState);
+  f("dropInTeam", dropInTeam);
+  f("dropInTime", dropInTime);
+  f("secsRemaining", secsRemaining);
+  f("secondaryTime", secondaryTime);
+  for(int t = 0; t < 2; ++t)
+  {
+    auto named = [&](const char* field) -> const char*
+    {
+      snprintf(name, sizeof(name), "%s%s", teamNames[t], field);
+      return name;
+    };
+    f(named("teamNumber"), teamNumber[t]);
+    f(named("teamColour"), teamColour[t]);
+    f(named("score"), score[t]);
+    f(named("penaltyShot"), penaltyShot[t]);
+    f(named("singleShots"), singleShots[t]);
+    f(named("coachSequence"), coachSequence[t]);
+    for(int p = 0; p < MAX_NUM_PLAYERS; ++p)
+    {
+      snprintf(name, sizeof(name), "%splayer%d.penalty", teamNames[t], p + 1);
+      f(name, penalty[t][p]);
+      snprintf(name, sizeof(name), "%splayer%d.secsTillUnpenalised", teamNames[t], p + 1);
+      f(name, secsTillUnpenalised[t][p]);
+    }
+  }
+
+  f("message.timestamp", messageTimestamp);
+  f("message.teamNum", teamNum);
+  f("message.playerNum", playerNum);
+  f("message.fallen", fallen);
+  f("message.pose.x", poseX);
+  f("message.pose.y", poseY);
+  f("message.pose.theta", poseTheta);
+  f("message.ballAge", ballAge);
+  f("message.ball.x", ballX);
+  f("message.ball.y", ballY);
+  f("message.intention", intention);
+}
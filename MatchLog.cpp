@@ -0,0 +1,383 @@
+/**
+ * @file MatchLog.cpp
+ * Implements the writer and reader of compressed match logs.
+ */
+
+#include "MatchLog.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include "DeltaCoding.h"
+#include "Log.h"
+
+static const unsigned MAX_BLOCK_SIZE = 1 << 24; /**< Larger blocks are considered corrupt. */
+static const uint32_t RESYNC = 0x80000000; /**< The flag in the raw size of a block that resets the model. */
+static const int BLOCKS_PER_RESYNC = 32; /**< The model is reset in every this many blocks. */
+
+/** The types of records. */
+enum RecordType
+{
+  GAMECONTROL_KEYFRAME,
+  GAMECONTROL_DELTA,
+  TEAM_KEYFRAME,
+  TEAM_DELTA
+};
+
+/**
+ * Compresses a block with an adaptive binary range coder.
+ * @param model The probabilities. They are updated.
+ */
+static void compress(MatchLogModel& model, const std::vector<unsigned char>& input,
+                     std::vector<unsigned char>& output)
+{
+  uint64_t low = 0;
+  uint32_t range = 0xffffffff;
+  unsigned char cache = 0;
+  uint64_t cacheSize = 1;
+  output.clear();
+
+  // Emits the top byte of low, delaying 0xff bytes until a carry is resolved.
+  auto shiftLow = [&]
+  {
+    if((uint32_t) low < 0xff000000 || (low >> 32) != 0)
+    {
+      const unsigned char carry = (unsigned char) (low >> 32);
+      unsigned char byte = cache;
+      do
+      {
+        output.push_back((unsigned char) (byte + carry));
+        byte = 0xff;
+      }
+      while(--cacheSize != 0);
+      cache = (unsigned char) (low >> 24);
+    }
+    ++cacheSize;
+    low = (low & 0x00ffffff) << 8;
+  };
+
+  unsigned char previous = 0;
+  for(unsigned char byte : input)
+  {
+    uint16_t* probabilities = model.get(previous);
+    for(unsigned node = 1, i = 8; i-- > 0;)
+    {
+      const unsigned bit = (byte >> i) & 1;
+      uint16_t& p = probabilities[node];
+      const uint32_t bound = (range >> MatchLogModel::numOfBits) * p;
+      if(bit)
+      {
+        low += bound;
+        range -= bound;
+        p -= p >> MatchLogModel::shift;
+      }
+      else
+      {
+        range = bound;
+        p += ((1 << MatchLogModel::numOfBits) - p) >> MatchLogModel::shift;
+      }
+      while(range < (1u << 24))
+      {
+        range <<= 8;
+        shiftLow();
+      }
+      node = node * 2 + bit;
+    }
+    previous = byte;
+  }
+  for(int i = 0; i < 5; ++i)
+    shiftLow();
+}
+
+/**
+ * Decompresses a block.
+ * @param model The probabilities. They are updated.
+ * @param input The compressed block.
+ * @param output The block is stored here. Its size must already be set.
+ */
+static void decompress(MatchLogModel& model, const std::vector<unsigned char>& input,
+                       std::vector<unsigned char>& output)
+{
+  size_t in = 0;
+  auto next = [&]() -> uint32_t {return in < input.size() ? input[in++] : 0;};
+  uint32_t range = 0xffffffff;
+  uint32_t code = 0;
+  for(int i = 0; i < 5; ++i)
+    code = code << 8 | next();
+
+  unsigned char previous = 0;
+  for(unsigned char& byte : output)
+  {
+    uint16_t* probabilities = model.get(previous);
+    unsigned node = 1;
+    while(node < 256)
+    {
+      uint16_t& p = probabilities[node];
+      const uint32_t bound = (range >> MatchLogModel::numOfBits) * p;
+      if(code < bound)
+      {
+        range = bound;
+        p += ((1 << MatchLogModel::numOfBits) - p) >> MatchLogModel::shift;
+        node *= 2;
+      }
+      else
+      {
+        code -= bound;
+        range -= bound;
+        p -= p >> MatchLogModel::shift;
+        node = node * 2 + 1;
+      }
+      while(range < (1u << 24))
+      {
+        range <<= 8;
+        code = code << 8 | next();
+      }
+    }
+    previous = byte = (unsigned char) node;
+  }
+}
+
+void MatchLogContext::reset()
+{
+  hasGameControl = false;
+  timestamp = 0;
+  interval = 0;
+  for(TeamSlot& slot : teamSlots)
+    slot.size = 0;
+}
+
+MatchLogWriter::MatchLogWriter(const char* path, int recordsPerBlock) :
+  file(fopen(path, "wb")), recordsPerBlock(recordsPerBlock), numOfRecords(0), numOfBlocks(0), size(0)
+{
+  context.reset();
+  if(!file)
+  {
+    LOG("MatchLogWriter: cannot open %s: %s", path, strerror(errno));
+    return;
+  }
+  fwrite(MATCH_LOG_HEADER, 4, 1, file);
+  fputc(MATCH_LOG_VERSION, file);
+  size = 5;
+}
+
+MatchLogWriter::~MatchLogWriter()
+{
+  close();
+}
+
+void MatchLogWriter::writeHeader(int type, long long timestamp)
+{
+  // The time stamp is predicted to follow at the same interval as before.
+  const long long error = timestamp - context.timestamp - context.interval;
+  block.push_back((unsigned char) type);
+  putVarint(block, (uint64_t) error << 1 ^ (uint64_t) (error >> 63));
+  context.interval = timestamp - context.timestamp;
+  context.timestamp = timestamp;
+}
+
+void MatchLogWriter::write(const RoboCupGameControlData& data, long long timestamp)
+{
+  if(!file)
+    return;
+  if(context.hasGameControl)
+  {
+    RoboCupGameControlData& predicted = context.gameControl;
+    ++predicted.packetNumber;
+    writeHeader(GAMECONTROL_DELTA, timestamp);
+    putDelta(block, (const char*) &data, (const char*) &predicted, sizeof(data));
+  }
+  else
+  {
+    writeHeader(GAMECONTROL_KEYFRAME, timestamp);
+    block.insert(block.end(), (const unsigned char*) &data, (const unsigned char*) (&data + 1));
+    context.hasGameControl = true;
+  }
+  context.gameControl = data;
+  if(++numOfRecords >= recordsPerBlock)
+    flush();
+}
+
+void MatchLogWriter::write(const SPLStandardMessage& message, int size, long long timestamp)
+{
+  if(!file || size < (int) offsetof(SPLStandardMessage, teamNum) + 1 || size > (int) sizeof(message))
+    return;
+  MatchLogContext::TeamSlot& slot = context.getTeamSlot(message.teamNum, message.playerNum);
+  if(slot.size == size && slot.teamNum == message.teamNum && slot.playerNum == message.playerNum)
+  {
+    writeHeader(TEAM_DELTA, timestamp);
+    block.push_back((unsigned char) message.teamNum);
+    block.push_back((unsigned char) message.playerNum);
+    putDelta(block, (const char*) &message, slot.data, size);
+  }
+  else
+  {
+    writeHeader(TEAM_KEYFRAME, timestamp);
+    putVarint(block, size);
+    block.insert(block.end(), (const unsigned char*) &message, (const unsigned char*) &message + size);
+    slot.size = size;
+    slot.teamNum = message.teamNum;
+    slot.playerNum = message.playerNum;
+  }
+  memcpy(slot.data, &message, size);
+  if(++numOfRecords >= recordsPerBlock)
+    flush();
+}
+
+void MatchLogWriter::flush()
+{
+  if(!file || block.empty())
+    return;
+  const bool resync = numOfBlocks++ % BLOCKS_PER_RESYNC == 0;
+  if(resync)
+    model.reset();
+  compress(model, block, compressed);
+  const uint32_t header[2] = {(uint32_t) block.size() | (resync ? RESYNC : 0), (uint32_t) compressed.size()};
+  if(fwrite(header, sizeof(header), 1, file) != 1 ||
+     fwrite(compressed.data(), compressed.size(), 1, file) != 1)
+    LOG("MatchLogWriter::flush() failed: %s", strerror(errno));
+  fflush(file);
+  size += (long) (sizeof(header) + compressed.size());
+  block.clear();
+  numOfRecords = 0;
+  context.reset();
+}
+
+void MatchLogWriter::close()
+{
+  if(file)
+  {
+    flush();
+    fclose(file);
+    file = 0;
+  }
+}
+
+MatchLogReader::MatchLogReader(const char* path) :
+  file(fopen(path, "rb")), position(0), synchronized(false)
+{
+  context.reset();
+  char header[5];
+  if(!file)
+    LOG("MatchLogReader: cannot open %s: %s", path, strerror(errno));
+  else if(fread(header, sizeof(header), 1, file) != 1 || memcmp(header, MATCH_LOG_HEADER, 4) ||
+          header[4] != MATCH_LOG_VERSION)
+  {
+    LOG("MatchLogReader: %s is not a match log of version %d", path, MATCH_LOG_VERSION);
+    fclose(file);
+    file = 0;
+  }
+}
+
+MatchLogReader::~MatchLogReader()
+{
+  if(file)
+    fclose(file);
+}
+
+bool MatchLogReader::readBlock()
+{
+  uint32_t header[2];
+  if(!file || fread(header, sizeof(header), 1, file) != 1)
+    return false;
+  const bool resync = (header[0] & RESYNC) != 0;
+  header[0] &= ~RESYNC;
+  if(header[0] > MAX_BLOCK_SIZE || header[1] > MAX_BLOCK_SIZE || !(resync || synchronized))
+    return false;
+  compressed.resize(header[1]);
+  if(header[1] && fread(compressed.data(), header[1], 1, file) != 1)
+    return false;
+  if(resync)
+    model.reset();
+  synchronized = true;
+  block.resize(header[0]);
+  decompress(model, compressed, block);
+  position = 0;
+  context.reset();
+  return true;
+}
+
+bool MatchLogReader::read(MatchLogEntry& entry)
+{
+  while(position >= block.size())
+    if(!readBlock())
+      return false;
+
+  const unsigned char* p = block.data() + position;
+  const unsigned char* const end = block.data() + block.size();
+  const int type = *p++;
+  uint64_t error;
+  if(!getVarint(p, end, error))
+    return false;
+  const long long timestamp = context.timestamp + context.interval + (long long) (error >> 1 ^ -(error & 1));
+  context.interval = timestamp - context.timestamp;
+  context.timestamp = timestamp;
+  entry.timestamp = timestamp;
+
+  switch(type)
+  {
+    case GAMECONTROL_KEYFRAME:
+      if(end - p < (long) sizeof(RoboCupGameControlData))
+        return false;
+      memcpy(&context.gameControl, p, sizeof(RoboCupGameControlData));
+      p += sizeof(RoboCupGameControlData);
+      context.hasGameControl = true;
+      break;
+
+    case GAMECONTROL_DELTA:
+      if(!context.hasGameControl)
+        return false;
+      ++context.gameControl.packetNumber;
+      if(!getDelta(p, end, (char*) &context.gameControl, sizeof(RoboCupGameControlData)))
+        return false;
+      break;
+
+    case TEAM_KEYFRAME:
+    {
+      uint64_t size;
+      if(!getVarint(p, end, size) || size < offsetof(SPLStandardMessage, teamNum) + 1 ||
+         size > sizeof(SPLStandardMessage) || size > (uint64_t) (end - p))
+        return false;
+      // The record is not aligned within the block.
+      int8_t teamNum, playerNum;
+      memcpy(&teamNum, p + offsetof(SPLStandardMessage, teamNum), sizeof(teamNum));
+      memcpy(&playerNum, p + offsetof(SPLStandardMessage, playerNum), sizeof(playerNum));
+      MatchLogContext::TeamSlot& slot = context.getTeamSlot(teamNum, playerNum);
+      slot.size = (int) size;
+      slot.teamNum = teamNum;
+      slot.playerNum = playerNum;
+      memcpy(slot.data, p, size);
+      p += size;
+      entry.type = MatchLogEntry::teamMessage;
+      entry.size = slot.size;
+      memcpy(entry.data, slot.data, slot.size);
+      position = p - block.data();
+      return true;
+    }
+
+    case TEAM_DELTA:
+    {
+      if(end - p < 2)
+        return false;
+      const int8_t teamNum = (int8_t) *p++;
+      const int8_t playerNum = (int8_t) *p++;
+      MatchLogContext::TeamSlot& slot = context.getTeamSlot(teamNum, playerNum);
+      if(!slot.size || slot.teamNum != teamNum || slot.playerNum != playerNum ||
+         !getDelta(p, end, slot.data, slot.size))
+        return false;
+      entry.type = MatchLogEntry::teamMessage;
+      entry.size = slot.size;
+      memcpy(entry.data, slot.data, slot.size);
+      position = p - block.data();
+      return true;
+    }
+
+    default:
+      return false;
+  }
+
+  entry.type = MatchLogEntry::gameControlData;
+  entry.size = sizeof(RoboCupGameControlData);
+  entry.gameControl = context.gameControl;
+  position = p - block.data();
+  return true;
+}
@@ -0,0 +1,209 @@
+/**
+ * @file MatchLog.h
+ * Declares the writer and reader of compressed match logs. A match log
+ * records the GameController packets and team messages received with
+ * their times of arrival.
+ *
+ * Consecutive packets are nearly identical, so each one is stored as the
+ * XOR with its predecessor (team messages: the predecessor from the same
+ * player), with the runs of zeros removed. The packet number is predicted
+ * to increase by one, so it does not cost anything. These records are
+ * grouped into blocks, and each block is compressed with an adaptive
+ * binary range coder using the previous byte as context. Each block starts
+ * with keyframes, but the probabilities of the coder are carried over from
+ * the previous block, because small blocks are too short to learn them.
+ * They are only reset at resync points, i.e. in the first block and then
+ * every few dozen blocks. Decoding can start at any resync point.
+ *
+ * File format: "RMLg", version (1 byte), then blocks of
+ * raw size (4 bytes, the highest bit marks a resync point),
+ * compressed size (4 bytes), compressed data.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "RoboCupGameControlData.h"
+#include "SPLStandardMessage.h"
+
+#define MATCH_LOG_HEADER  "RMLg"
+#define MATCH_LOG_VERSION 2
+
+/**
+ * An entry of a match log.
+ */
+struct MatchLogEntry
+{
+  enum Type
+  {
+    gameControlData, /**< A RoboCupGameControlData packet. */
+    teamMessage /**< A SPLStandardMessage. Only the bytes sent are stored. */
+  };
+
+  Type type; /**< The type of the packet. */
+  long long timestamp; /**< When the packet was received in µs. */
+  int size; /**< The number of bytes of the packet. */
+  union
+  {
+    RoboCupGameControlData gameControl; /**< The packet if type is gameControlData. */
+    char data[sizeof(SPLStandardMessage)]; /**< The raw bytes. Use getTeamMessage() for type teamMessage. */
+  };
+
+  /** Returns the team message. The bytes beyond size are undefined. */
+  const SPLStandardMessage& getTeamMessage() const {return *(const SPLStandardMessage*) data;}
+};
+
+/**
+ * The state shared by writer and reader that determines how a record is
+ * predicted from the previous ones. It is reset at the start of each block.
+ */
+struct MatchLogContext
+{
+  enum {numOfTeamSlots = 16}; /**< The number of players whose previous messages are kept. */
+
+  /** The previous message of a player. */
+  struct TeamSlot
+  {
+    int size; /**< The size of the message. 0 if the slot is empty. */
+    int8_t teamNum; /**< The team of the player. */
+    int8_t playerNum; /**< The number of the player. */
+    char data[sizeof(SPLStandardMessage)]; /**< The message. */
+  };
+
+  bool hasGameControl; /**< Is there a previous GameController packet? */
+  RoboCupGameControlData gameControl; /**< The previous GameController packet. */
+  long long timestamp; /**< The time of the previous record in µs. */
+  long long interval; /**< The time between the previous two records in µs. */
+  TeamSlot teamSlots[numOfTeamSlots]; /**< The previous messages of players. */
+
+  /** Forgets all previous records. */
+  void reset();
+
+  /** Returns the slot of a player. */
+  TeamSlot& getTeamSlot(int8_t teamNum, int8_t playerNum)
+  {
+    return teamSlots[((uint8_t) teamNum * 7 + (uint8_t) playerNum) % numOfTeamSlots];
+  }
+};
+
+/**
+ * The adaptive probabilities of the range coder. Each byte is coded as
+ * eight binary decisions along a bit tree, in the context of the previous
+ * byte. Probabilities are 11 bit values of a 0 bit.
+ */
+struct MatchLogModel
+{
+  enum {numOfBits = 11, shift = 5};
+
+  std::vector<uint16_t> probabilities;
+
+  MatchLogModel() : probabilities(256 * 256) {reset();}
+
+  /** Forgets all statistics, i.e. all bits are equally likely. */
+  void reset() {std::fill(probabilities.begin(), probabilities.end(), 1 << (numOfBits - 1));}
+
+  /** Returns the 256 probabilities of the bit tree after a certain byte. */
+  uint16_t* get(unsigned char context) {return &probabilities[context << 8];}
+};
+
+/**
+ * @class MatchLogWriter
+ * Writes a compressed match log. Records are kept in memory until their
+ * block is complete, so the last block is only written by close() or the
+ * destructor.
+ */
+class MatchLogWriter
+{
+public:
+  /**
+   * Constructor.
+   * @param path The path of the file written.
+   * @param recordsPerBlock The number of records per block.
+   */
+  MatchLogWriter(const char* path, int recordsPerBlock = 1024);
+
+  /** Writes the last block and closes the file. */
+  ~MatchLogWriter();
+
+  /** Could the file be opened? */
+  bool isOpen() const {return file != 0;}
+
+  /**
+   * Adds a GameController packet.
+   * @param data The packet.
+   * @param timestamp When it was received in µs.
+   */
+  void write(const RoboCupGameControlData& data, long long timestamp);
+
+  /**
+   * Adds a team message.
+   * @param message The message.
+   * @param size The number of bytes received.
+   * @param timestamp When it was received in µs.
+   */
+  void write(const SPLStandardMessage& message, int size, long long timestamp);
+
+  /** Writes the current block. */
+  void flush();
+
+  /** Writes the last block and closes the file. */
+  void close();
+
+  /** Returns the number of bytes written to the file so far. */
+  long getSize() const {return size;}
+
+private:
+  /** Adds the type and time stamp of a record. */
+  void writeHeader(int type, long long timestamp);
+
+  FILE* file; /**< The file written. 0 if it could not be opened. */
+  int recordsPerBlock; /**< The number of records per block. */
+  int numOfRecords; /**< The number of records in the current block. */
+  int numOfBlocks; /**< The number of blocks written. */
+  long size; /**< The number of bytes written. */
+  std::vector<unsigned char> block; /**< The records of the current block before compression. */
+  std::vector<unsigned char> compressed; /**< The buffer for the compressed block. */
+  MatchLogContext context; /**< The previous records. */
+  MatchLogModel model; /**< The probabilities learned from the previous blocks. */
+};
+
+/**
+ * @class MatchLogReader
+ * Reads a compressed match log.
+ */
+class MatchLogReader
+{
+public:
+  /**
+   * Constructor.
+   * @param path The path of the file read.
+   */
+  MatchLogReader(const char* path);
+
+  ~MatchLogReader();
+
+  /** Could the file be opened and is it a match log? */
+  bool isOpen() const {return file != 0;}
+
+  /**
+   * Reads the next entry.
+   * @param entry The entry is stored here.
+   * @return Was there another entry? False at the end of the file or if it is corrupt.
+   */
+  bool read(MatchLogEntry& entry);
+
+private:
+  /** Reads and decompresses the next block. */
+  bool readBlock();
+
+  FILE* file; /**< The file read. 0 if it could not be opened. */
+  std::vector<unsigned char> block; /**< The records of the current block. */
+  std::vector<unsigned char> compressed; /**< The buffer for the compressed block. */
+  size_t position; /**< The position of the next record in block. */
+  bool synchronized; /**< Has a resync point been read, i.e. is the model valid? */
+  MatchLogContext context; /**< The previous records. */
+  MatchLogModel model; /**< The probabilities learned from the previous blocks. */
+};
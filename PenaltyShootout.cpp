@@ -0,0 +1,140 @@
+/**
+ * @file PenaltyShootout.cpp
+ * Implements a tracker of penalty shootouts.
+ */
+
+#include "PenaltyShootout.h"
+
+/** Returns a mask of the bits of the first shots. */
+static uint16_t getMask(int shots)
+{
+  return shots >= PenaltyShootout::maxShots ? 0xffff : (uint16_t) ((1u << shots) - 1);
+}
+
+PenaltyShootout::PenaltyShootout()
+: active(false),
+  firstShooterIsOwn(false),
+  ownTeamNumber(0),
+  shootingTeam(0),
+  numOfEvents(0)
+{
+  for(Team& team : teams)
+  {
+    team.shots = 0;
+    team.goals = 0;
+    team.pending = -1;
+  }
+}
+
+void PenaltyShootout::add(Event::Type type, bool own, int shot)
+{
+  if(numOfEvents < maxEvents)
+  {
+    Event& event = events[numOfEvents++];
+    event.type = type;
+    event.own = own;
+    event.shot = shot;
+  }
+}
+
+void PenaltyShootout::resolvePending()
+{
+  for(int side = 0; side < 2; ++side)
+    if(teams[side].pending >= 0)
+    {
+      add(Event::missed, side != 0, teams[side].pending);
+      teams[side].pending = -1;
+    }
+}
+
+int PenaltyShootout::update(const RoboCupGameControlData& data, int teamNumber)
+{
+  numOfEvents = 0;
+  ownTeamNumber = teamNumber;
+  const TeamInfo* infos[2] = {0, 0};
+  for(int i = 0; i < 2; ++i)
+    if(teamNumber && data.teams[i].teamNumber == teamNumber)
+    {
+      infos[true] = &data.teams[i];
+      infos[false] = &data.teams[i ^ 1];
+    }
+
+  if(data.secondaryState != STATE2_PENALTYSHOOT || !infos[true])
+  {
+    if(active)
+    {
+      resolvePending();
+      add(Event::finished, false, 0);
+      active = false;
+    }
+    return numOfEvents;
+  }
+
+  if(!active)
+  {
+    active = true;
+    firstShooterIsOwn = data.kickOffTeam == teamNumber;
+    for(Team& team : teams)
+    {
+      team.shots = 0;
+      team.goals = 0;
+      team.pending = -1;
+    }
+    add(Event::started, false, 0);
+  }
+  shootingTeam = data.kickOffTeam;
+
+  int shots[2];
+  uint16_t goals[2];
+  for(int side = 0; side < 2; ++side)
+  {
+    Team& team = teams[side];
+    shots[side] = infos[side]->penaltyShot < maxShots ? infos[side]->penaltyShot : (int) maxShots;
+    goals[side] = infos[side]->singleShots & getMask(shots[side]);
+    if(shots[side] < team.shots || team.goals & ~goals[side])
+    {
+      // The referee corrected a mistake. Follow without events.
+      team.shots = shots[side];
+      team.goals = goals[side];
+      team.pending = -1;
+    }
+  }
+
+  // First the outcomes of the shots already known.
+  for(int side = 0; side < 2; ++side)
+  {
+    Team& team = teams[side];
+    for(unsigned bits = goals[side] & ~team.goals & getMask(team.shots); bits; bits &= bits - 1)
+    {
+      const int shot = __builtin_ctz(bits);
+      add(Event::goal, side != 0, shot);
+      if(team.pending == shot)
+        team.pending = -1;
+    }
+    team.goals |= goals[side] & getMask(team.shots);
+  }
+
+  // Then the new shots. Starting a shot decides the ones still pending.
+  for(int side = 0; side < 2; ++side)
+  {
+    Team& team = teams[side];
+    if(shots[side] == team.shots)
+      continue;
+    if(!teams[0].shots && !teams[1].shots)
+      firstShooterIsOwn = side != 0;
+    resolvePending();
+    for(int shot = team.shots; shot < shots[side]; ++shot)
+    {
+      add(Event::attempt, side != 0, shot);
+      if(goals[side] >> shot & 1)
+        add(Event::goal, side != 0, shot);
+      else if(shot == shots[side] - 1)
+        team.pending = shot;
+      else
+        add(Event::missed, side != 0, shot); // the packets in between were lost
+    }
+    team.shots = shots[side];
+    team.goals = goals[side];
+  }
+  return numOfEvents;
+}
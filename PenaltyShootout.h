@@ -0,0 +1,102 @@
+/**
+ * @file PenaltyShootout.h
+ * Declares a tracker of penalty shootouts.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "RoboCupGameControlData.h"
+
+/**
+ * @class PenaltyShootout
+ * Tracks a penalty shootout from the packets of the GameController. Each
+ * team's penaltyShot counts the shots it started and bit i of its
+ * singleShots is set when shot i scored. A shot is counted as missed when
+ * a later shot starts or the shootout ends without its bit being set.
+ *
+ * update() compares each packet with the previous one, so only new shots
+ * and new bits are looked at. All queries are O(1).
+ */
+class PenaltyShootout
+{
+public:
+  enum {maxShots = 16}; /**< The number of bits of singleShots. */
+
+  /** Something that happened in the shootout. */
+  struct Event
+  {
+    enum Type
+    {
+      started, /**< The shootout started. */
+      attempt, /**< A team started a shot. */
+      goal, /**< A shot scored. */
+      missed, /**< A shot did not score. */
+      finished /**< The shootout ended. */
+    };
+
+    Type type;
+    bool own; /**< Does the event concern our team? Not used by started and finished. */
+    int shot; /**< The number of the shot of the team starting with 0. Not used by started and finished. */
+  };
+
+  PenaltyShootout();
+
+  /**
+   * Adds a packet.
+   * @param data The packet.
+   * @param teamNumber The number of our team.
+   * @return The number of events caused by the packet. See getEvent().
+   */
+  int update(const RoboCupGameControlData& data, int teamNumber);
+
+  /** Returns an event of the last update(). The index must be smaller than its result. */
+  const Event& getEvent(int index) const {return events[index];}
+
+  /** Is a shootout in progress? */
+  bool isActive() const {return active;}
+
+  /** Returns the number of shots a team started. */
+  int getShots(bool own) const {return teams[own].shots;}
+
+  /** Returns the number of goals a team scored. */
+  int getScore(bool own) const {return __builtin_popcount(teams[own].goals);}
+
+  /** Does our team take the current shot? */
+  bool isShooting() const {return active && shootingTeam == ownTeamNumber;}
+
+  /** Will our team take the next shot? Teams alternate, starting with the team that shot first. */
+  bool isShootingNext() const
+  {
+    return active && (teams[true].shots != teams[false].shots ? teams[true].shots < teams[false].shots
+                                                               : firstShooterIsOwn);
+  }
+
+  /** Is a shot of a team waiting for its outcome? */
+  bool isPending(bool own) const {return teams[own].pending >= 0;}
+
+private:
+  enum {maxEvents = 8 * maxShots}; /**< More events than a single packet can cause. */
+
+  /** The state of a team. */
+  struct Team
+  {
+    int shots; /**< The number of shots started. */
+    uint16_t goals; /**< Bit i is set if shot i scored. */
+    int pending; /**< The shot without outcome or -1. */
+  };
+
+  /** Adds an event if there is space. */
+  void add(Event::Type type, bool own, int shot);
+
+  /** Adds missed events for all pending shots. */
+  void resolvePending();
+
+  bool active; /**< Is a shootout in progress? */
+  bool firstShooterIsOwn; /**< Did our team shoot first? */
+  int ownTeamNumber; /**< The number of our team. */
+  int shootingTeam; /**< The number of the team taking the current shot. */
+  Team teams[2]; /**< The opponent (index 0) and our team (index 1). */
+  Event events[maxEvents]; /**< The events of the last update(). */
+  int numOfEvents; /**< The number of events of the last update(). */
+};
@@ -0,0 +1,113 @@
+/**
+ * @file PerfCounters.cpp
+ * Implements access to the hardware performance counters of the CPU.
+ */
+
+#include "PerfCounters.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/** The type and configuration of each counter, indexed by PerfCounters::Counter. */
+static const struct {uint32_t type; uint64_t config;} events[PerfCounters::numOfCounters] =
+{
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+  {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+};
+
+const char* PerfCounters::getName(Counter counter)
+{
+  static const char* names[numOfCounters] = {"cycles", "instructions", "L1d misses", "LLC misses", "branch misses"};
+  return names[counter];
+}
+
+PerfCounters::PerfCounters()
+: leader(-1),
+  numOfOpen(0),
+  kernel(true)
+{
+  for(int& fd : fds)
+    fd = -1;
+
+  // The system calls are part of the costs, but counting them is only
+  // allowed if kernel.perf_event_paranoid <= 1.
+  open();
+  if(!numOfOpen)
+  {
+    kernel = false;
+    open();
+  }
+}
+
+PerfCounters::~PerfCounters()
+{
+  closeAll();
+}
+
+void PerfCounters::open()
+{
+  closeAll();
+  for(int i = 0; i < numOfCounters; ++i)
+  {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.disabled = leader == -1; // members follow the leader
+    attr.exclude_kernel = !kernel;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+    if(fds[i] != -1)
+    {
+      if(leader == -1)
+        leader = fds[i];
+      ++numOfOpen;
+    }
+  }
+}
+
+void PerfCounters::closeAll()
+{
+  for(int& fd : fds)
+  {
+    if(fd != -1)
+      close(fd);
+    fd = -1;
+  }
+  leader = -1;
+  numOfOpen = 0;
+}
+
+void PerfCounters::start()
+{
+  if(leader != -1)
+  {
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfCounters::stop(long long values[numOfCounters])
+{
+  if(leader == -1)
+    return;
+  ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  // The group is read as {nr, time_enabled, time_running, value[nr]} in the order the counters were opened.
+  uint64_t data[3 + numOfCounters];
+  if(read(leader, data, sizeof(data)) < (ssize_t) (3 * sizeof(uint64_t)) || (int) data[0] != numOfOpen || !data[2])
+    return;
+  const double scale = (double) data[1] / (double) data[2];
+  for(int i = 0, j = 3; i < numOfCounters; ++i)
+    if(fds[i] != -1)
+      values[i] += (long long) ((double) data[j++] * scale);
+}
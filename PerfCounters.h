@@ -0,0 +1,69 @@
+/**
+ * @file PerfCounters.h
+ * Declares access to the hardware performance counters of the CPU.
+ */
+
+#pragma once
+
+/**
+ * @class PerfCounters
+ * Counts hardware events of the calling thread with perf_event_open(),
+ * including the time spent in system calls if kernel.perf_event_paranoid
+ * <= 1 and only in user space if it is 2. All counters form a group, so
+ * they count exactly the same code. Counters the CPU or the kernel does not
+ * provide, e.g. in a virtual machine, are unavailable and count nothing.
+ */
+class PerfCounters
+{
+public:
+  /** The events counted. */
+  enum Counter
+  {
+    cycles,
+    instructions,
+    l1Misses, /**< Level 1 data cache read misses. */
+    llcMisses, /**< Last level cache misses. */
+    branchMisses,
+    numOfCounters
+  };
+
+  /** Returns the name of a counter. */
+  static const char* getName(Counter counter);
+
+  /** Opens the counters for the calling thread. They are not counting yet. */
+  PerfCounters();
+
+  ~PerfCounters();
+
+  /** Can a counter be read? */
+  bool isAvailable(Counter counter) const {return fds[counter] != -1;}
+
+  /** Can any counter be read? */
+  bool isOpen() const {return leader != -1;}
+
+  /** Do the counters include the kernel, i.e. system calls? */
+  bool countsKernel() const {return isOpen() && kernel;}
+
+  /** Resets all counters and starts counting. */
+  void start();
+
+  /**
+   * Stops counting and adds the counts since start() to values. If the
+   * kernel had to share the hardware with other users, the counts are
+   * extrapolated to the whole time.
+   * @param values The counts are added here, indexed by Counter.
+   */
+  void stop(long long values[numOfCounters]);
+
+private:
+  /** Opens all counters that are available. */
+  void open();
+
+  /** Closes all counters. */
+  void closeAll();
+
+  int fds[numOfCounters]; /**< The file descriptor of each counter or -1 if it is unavailable. */
+  int leader; /**< The file descriptor of the group leader or -1 if no counter is available. */
+  int numOfOpen; /**< The number of counters available. */
+  bool kernel; /**< Are events in the kernel counted? */
+};
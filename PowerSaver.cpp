@@ -0,0 +1,120 @@
+/**
+ * @file PowerSaver.cpp
+ * Implements a scheduler that keeps the wakeups of the main loop low on
+ * battery-powered robots.
+ */
+
+#include "PowerSaver.h"
+#include "Transport.h"
+#include "RoboCupGameControlData.h"
+#include "Log.h"
+#include "SystemTime.h"
+
+#include <time.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+/**
+ * Returns the resources used by all threads of the process.
+ * @param wakeups The number of voluntary context switches is stored here.
+ *                Each of them ends with a wakeup.
+ * @param switches The number of voluntary and involuntary context switches
+ *                 is stored here.
+ * @return The CPU time used in µs.
+ */
+static long long getUsage(long& wakeups, long& switches)
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  wakeups = usage.ru_nvcsw;
+  switches = usage.ru_nvcsw + usage.ru_nivcsw;
+  return ((long long) usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+         + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+PowerSaver::PowerSaver(int slack)
+: connected(false),
+  listening(true),
+  period(PERIOD),
+  lastTick(0),
+  wakeups(0)
+{
+  if(prctl(PR_SET_TIMERSLACK, (unsigned long) slack * 1000000))
+    LOG("PowerSaver: Could not set timer slack");
+  Log::setTimerSlack((unsigned long) slack * 1000000);
+  reportTime = getMicroseconds();
+  reportCpuTime = getUsage(reportWakeups, reportSwitches);
+  schedule(reportTime);
+}
+
+void PowerSaver::schedule(long long now)
+{
+  const long long length = period * 1000LL;
+  nextTick = (now / length + 1) * length;
+}
+
+void PowerSaver::update(uint8_t state, bool connected)
+{
+  this->connected = connected;
+  listening = !connected || (state != STATE_INITIAL && state != STATE_FINISHED);
+  const int target = !connected ? (period > PERIOD ? period : PERIOD) : listening ? PERIOD : IDLE_PERIOD;
+  if(target != period)
+  {
+    period = target;
+    const long long previous = nextTick;
+    schedule(getMicroseconds());
+    if(previous < nextTick)
+      nextTick = previous; // a tick already scheduled is not skipped
+  }
+}
+
+bool PowerSaver::wait(Transport* transport)
+{
+  // While playing, the packets of the GameController wake up the loop anyway.
+  // Ticks are done at these wakeups and the timer is only a fallback.
+  const bool followPackets = connected && listening;
+  const long long deadline = followPackets ? lastTick + 2000LL * period : nextTick;
+  const long long now = getMicroseconds();
+  if(now < deadline)
+  {
+    if(listening && transport)
+      transport->wait((int) ((deadline - now + 999) / 1000));
+    else
+    {
+      struct timespec ts;
+      ts.tv_sec = (time_t) (deadline / 1000000);
+      ts.tv_nsec = (long) (deadline % 1000000 * 1000);
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0);
+    }
+    ++wakeups;
+  }
+
+  const long long after = getMicroseconds();
+  if(followPackets ? after - lastTick < 500LL * period : after < nextTick)
+    return false;
+  if(!connected && period < MAX_PERIOD)
+    period = period * 2 < MAX_PERIOD ? period * 2 : MAX_PERIOD;
+  lastTick = after;
+  schedule(after);
+  return true;
+}
+
+bool PowerSaver::getReport(Report& report)
+{
+  const long long now = getMicroseconds();
+  if(now - reportTime < REPORT_INTERVAL * 1000LL)
+    return false;
+  long processWakeups, switches;
+  const long long cpuTime = getUsage(processWakeups, switches);
+  const double seconds = (double) (now - reportTime) / 1000000.0;
+  report.wakeupsPerSecond = (double) (processWakeups - reportWakeups) / seconds;
+  report.loopWakeupsPerSecond = wakeups / seconds;
+  report.contextSwitchesPerSecond = (double) (switches - reportSwitches) / seconds;
+  report.residency = (double) (cpuTime - reportCpuTime) / (double) (now - reportTime);
+  wakeups = 0;
+  reportTime = now;
+  reportCpuTime = cpuTime;
+  reportWakeups = processWakeups;
+  reportSwitches = switches;
+  return true;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file PowerSaver.h
+ * Declares a scheduler that keeps the wakeups of the main loop low on
+ * battery-powered robots.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class Transport;
+
+/**
+ * @class PowerSaver
+ * Periodic work such as alive signals and clock sync requests is only done
+ * at ticks, so it shares a single wakeup instead of each task setting its
+ * own timer. Timed ticks are multiples of the period on the monotonic clock
+ * rather than of the start time, so processes using the same period wake up
+ * together, and a timer slack lets the kernel merge them with other timers.
+ *
+ * The period adapts to the game:
+ * - While playing, packets wake up the loop at once. The GameController
+ *   sends them about every PERIOD, so ticks are done at these wakeups when
+ *   at least half a period passed since the previous tick. The timer only
+ *   wakes up the loop when no packet arrived for two periods.
+ * - In STATE_INITIAL and STATE_FINISHED nothing urgent can happen, so the
+ *   socket is not waited on. Packets queue up and are read at the next tick,
+ *   which is IDLE_PERIOD apart, i.e. they are handled up to IDLE_PERIOD late.
+ * - While the GameController is silent, the period doubles with each tick
+ *   up to MAX_PERIOD. The first packet still wakes up the loop at once.
+ */
+class PowerSaver
+{
+public:
+  static const int PERIOD = 500; /**< The time between ticks while playing in ms. As ALIVE_DELAY. */
+  static const int IDLE_PERIOD = 1000; /**< The time between ticks in STATE_INITIAL and STATE_FINISHED in ms. */
+  static const int MAX_PERIOD = 8000; /**< The longest time between ticks while the GameController is silent in ms. */
+  static const int TIMER_SLACK = 20; /**< How much later than requested the kernel may wake up the thread in ms. */
+  static const int REPORT_INTERVAL = 60000; /**< The time between two reports in ms. */
+
+  /**
+   * The activity of the process since the previous report. All threads are
+   * counted, including the background thread of the logger.
+   */
+  struct Report
+  {
+    double wakeupsPerSecond; /**< The number of times a thread blocked and was woken up again per s. */
+    double loopWakeupsPerSecond; /**< The number of returns from wait() per s. */
+    double contextSwitchesPerSecond; /**< The number of times a thread gave up the CPU voluntarily or not per s. */
+    double residency; /**< The share of the time the process ran on a CPU (0..1). */
+  };
+
+  /**
+   * Constructor. Sets the timer slack of the calling thread, which must be
+   * the one that calls wait(), and of the background thread of the logger.
+   * @param slack The timer slack in ms.
+   */
+  PowerSaver(int slack = TIMER_SLACK);
+
+  /**
+   * Adapts the period to the game. Should be called after each wait().
+   * @param state The game state of the last packet.
+   * @param connected Was a packet received within GAMECONTROLLER_TIMEOUT?
+   */
+  void update(uint8_t state, bool connected);
+
+  /**
+   * Waits until the next tick or, unless the game is idle, until a packet arrives.
+   * @param transport The transport packets arrive on. May be 0.
+   * @return Was a tick reached? Periodic work is due then.
+   */
+  bool wait(Transport* transport);
+
+  /** Are packets waited on? Otherwise, they are only read at ticks. */
+  bool isListening() const {return listening;}
+
+  /** Returns the time between the current ticks in ms. */
+  int getPeriod() const {return period;}
+
+  /**
+   * Returns the activity since the previous report once every REPORT_INTERVAL.
+   * @param report The activity is stored here.
+   * @return Is a report due? Otherwise, report was not changed.
+   */
+  bool getReport(Report& report);
+
+private:
+  /** Sets nextTick to the first multiple of the period after a time in µs. */
+  void schedule(long long now);
+
+  bool connected; /**< Was the GameController heard from recently? */
+  bool listening; /**< Are packets waited on? */
+  int period; /**< The time between ticks in ms. */
+  long long nextTick; /**< When the next tick is due in µs of the monotonic clock. */
+  long long lastTick; /**< When the last tick was done in µs of the monotonic clock. */
+  unsigned wakeups; /**< The number of returns from wait() since the previous report. */
+  long long reportTime; /**< When the previous report was made in µs of the monotonic clock. */
+  long long reportCpuTime; /**< The CPU time of the process at the previous report in µs. */
+  long reportWakeups; /**< The number of voluntary context switches of the process at the previous report. */
+  long reportSwitches; /**< The number of all context switches of the process at the previous report. */
+};
@@ -0,0 +1,179 @@
+/**
+ * @file Query.cpp
+ * A tool that converts match logs to columns and answers questions about
+ * many matches. The column files are distributed over threads, and each
+ * thread only scans the columns a query needs.
+ *
+ * Usage:
+ *   query export <match log> <column file>
+ *   query [-j <threads>] penalties <column file> ...
+ *   query [-j <threads>] ready-to-playing <column file> ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "MatchColumns.h"
+#include "League.h"
+#include "Log.h"
+#include "SystemTime.h"
+
+/** The partial or total result of a query. */
+struct Result
+{
+  unsigned penalties[256][NUM_OF_PENALTIES]; /**< Penalties given per team number and penalty. */
+  long long readyToPlaying; /**< The sum of the times from READY to PLAYING in µs. */
+  unsigned numOfReadyToPlaying; /**< The number of times summed. */
+  size_t numOfPackets; /**< The number of GameController packets scanned. */
+  unsigned numOfFiles; /**< The number of files scanned. */
+};
+
+/** Counts the penalties given, i.e. the changes of penalty columns to a value other than none. */
+static void countPenalties(const MatchColumns& columns, Result& result)
+{
+  for(int t = 0; t < 2; ++t)
+    for(int p = 0; p < MAX_NUM_PLAYERS; ++p)
+    {
+      const std::vector<uint8_t>& column = columns.penalty[t][p];
+      const std::vector<uint8_t>& team = columns.teamNumber[t];
+      auto count = [&](size_t index, uint8_t penalty)
+      {
+        if(penalty != PENALTY_NONE)
+          ++result.penalties[team[index]][penalty & (NUM_OF_PENALTIES - 1)];
+      };
+      if(!column.empty())
+        count(0, column[0]);
+      forEachChange(column.data(), column.size(), count);
+    }
+}
+
+/** Sums the times from entering READY to entering PLAYING. */
+static void sumReadyToPlaying(const MatchColumns& columns, Result& result)
+{
+  long long readyStart = -1;
+  auto update = [&](size_t index, uint8_t state)
+  {
+    if(state == STATE_READY)
+      readyStart = columns.timestamp[index];
+    else if(state == STATE_PLAYING && readyStart >= 0)
+    {
+      result.readyToPlaying += columns.timestamp[index] - readyStart;
+      ++result.numOfReadyToPlaying;
+      readyStart = -1;
+    }
+  };
+  if(!columns.state.empty())
+    update(0, columns.state[0]);
+  forEachChange(columns.state.data(), columns.state.size(), update);
+}
+
+/** A query that can be selected from the command line. */
+struct Query
+{
+  const char* name;
+  void (*run)(const MatchColumns& columns, Result& result);
+  const char* columns[5]; /**< The patterns of the names of the columns read, followed by 0. */
+};
+
+static const Query queries[] =
+{
+  {"penalties", countPenalties, {"state", "team0.teamNumber", "team1.teamNumber", "team?.player*.penalty"}},
+  {"ready-to-playing", sumReadyToPlaying, {"state", "timestamp"}}
+};
+
+/** Converts a match log to a column file. */
+static int exportColumns(const char* matchLog, const char* path)
+{
+  MatchLogReader reader(matchLog);
+  if(!reader.isOpen())
+    return 1;
+  MatchColumns columns;
+  columns.add(reader);
+  if(!columns.save(path))
+    return 1;
+  printf("%zu GameController packets, %zu team messages\n", columns.timestamp.size(), columns.messageTimestamp.size());
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  int numOfThreads = (int) std::thread::hardware_concurrency();
+  int i = 1;
+  if(i + 1 < argc && !strcmp(argv[i], "-j"))
+  {
+    numOfThreads = atoi(argv[i + 1]);
+    i += 2;
+  }
+  if(numOfThreads < 1)
+    numOfThreads = 1;
+  if(i + 3 == argc && !strcmp(argv[i], "export"))
+    return exportColumns(argv[i + 1], argv[i + 2]);
+
+  const Query* query = 0;
+  for(const Query& q : queries)
+    if(i < argc && !strcmp(argv[i], q.name))
+      query = &q;
+  if(!query || i + 1 >= argc)
+  {
+    fprintf(stderr, "usage: %s export <match log> <column file>\n"
+                    "       %s [-j <threads>] penalties|ready-to-playing <column file> ...\n", argv[0], argv[0]);
+    return 1;
+  }
+
+  const long long start = getNanoseconds();
+  Result total;
+  memset(&total, 0, sizeof(total));
+  std::mutex mutex;
+  std::atomic<int> next(i + 1);
+  std::vector<std::thread> threads;
+  for(int t = 0; t < numOfThreads; ++t)
+    threads.emplace_back([&]
+    {
+      Result* result = new Result;
+      memset(result, 0, sizeof(*result));
+      for(int file; (file = next++) < argc;)
+      {
+        MatchColumns columns;
+        if(!columns.load(argv[file], query->columns))
+          continue;
+        query->run(columns, *result);
+        result->numOfPackets += columns.state.size();
+        ++result->numOfFiles;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      for(int team = 0; team < 256; ++team)
+        for(int penalty = 0; penalty < NUM_OF_PENALTIES; ++penalty)
+          total.penalties[team][penalty] += result->penalties[team][penalty];
+      total.readyToPlaying += result->readyToPlaying;
+      total.numOfReadyToPlaying += result->numOfReadyToPlaying;
+      total.numOfPackets += result->numOfPackets;
+      total.numOfFiles += result->numOfFiles;
+      delete result;
+    });
+  for(std::thread& thread : threads)
+    thread.join();
+  const long long stop = getNanoseconds();
+
+  if(query->run == countPenalties)
+  {
+    printf("team  %-32s count\n", "penalty");
+    for(int team = 0; team < 256; ++team)
+      for(int penalty = 0; penalty < NUM_OF_PENALTIES; ++penalty)
+        if(total.penalties[team][penalty])
+          printf("%4d  %-32s %5u\n", team, getPenaltyName<DefaultLeague>((uint8_t) penalty),
+                 total.penalties[team][penalty]);
+  }
+  else if(total.numOfReadyToPlaying)
+    printf("READY to PLAYING: %.2f s on average over %u kick-offs\n",
+           total.readyToPlaying / 1e6 / total.numOfReadyToPlaying, total.numOfReadyToPlaying);
+  else
+    printf("READY to PLAYING: no kick-offs\n");
+  printf("%u files, %zu packets scanned in %.2f ms with %d threads\n", total.numOfFiles, total.numOfPackets,
+         (stop - start) / 1e6, numOfThreads);
+  Log::flush();
+  return total.numOfFiles ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file RateLimiter.cpp
+ * Implements a per-source token bucket rate limiter.
+ */
+
+#include "RateLimiter.h"
+
+#include <string.h>
+
+RateLimiter::RateLimiter(float rate, float burst)
+: rate(rate / 1000000.f),
+  burst(burst),
+  refillTime((long long) (burst / rate * 1000000.f))
+{
+  memset(buckets, 0, sizeof(buckets));
+}
+
+RateLimiter::Result RateLimiter::admit(uint32_t source, long long now)
+{
+  Bucket* free = 0;
+  unsigned index = (source * 2654435761u) >> 26; // Fibonacci hashing to 6 bits
+  for(int i = 0; i < numOfBuckets; ++i, index = (index + 1) & (numOfBuckets - 1))
+  {
+    Bucket& bucket = buckets[index];
+    if(bucket.used && bucket.source == source)
+    {
+      bucket.tokens += (float) (now - bucket.lastUpdate) * rate;
+      if(bucket.tokens > burst)
+        bucket.tokens = burst;
+      bucket.lastUpdate = now;
+      if(bucket.tokens < 1.f)
+        return rateLimited;
+      bucket.tokens -= 1.f;
+      return accepted;
+    }
+    else if(!free && (!bucket.used || now - bucket.lastUpdate >= refillTime))
+      free = &bucket;
+    if(!bucket.used)
+      break; // The source cannot be found behind a slot never used.
+  }
+
+  if(!free)
+    return tableFull;
+  free->source = source;
+  free->used = true;
+  free->tokens = burst - 1.f;
+  free->lastUpdate = now;
+  return accepted;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file RateLimiter.h
+ * Declares a per-source token bucket rate limiter.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @class RateLimiter
+ * Limits the packet rate accepted from each source address with a token
+ * bucket. The buckets are kept in a small open-addressing table with linear
+ * probing. A bucket that has been refilled completely is equivalent to a
+ * new one, so its slot is reused for other sources.
+ */
+class RateLimiter
+{
+public:
+  /** The result of an admission check. */
+  enum Result
+  {
+    accepted, /**< The packet is within the rate of its source. */
+    rateLimited, /**< The source has used up its tokens. */
+    tableFull /**< There are too many sources sending at the same time. */
+  };
+
+  /**
+   * Constructor.
+   * @param rate The number of packets per second accepted from each source in the long run.
+   * @param burst The number of packets accepted from a source in a row.
+   */
+  RateLimiter(float rate, float burst);
+
+  /**
+   * Checks whether a packet is accepted and consumes a token if it is.
+   * @param source The IPv4 address of the sender.
+   * @param now The current time in µs of the monotonic clock.
+   * @return Is the packet accepted and if not, why?
+   */
+  Result admit(uint32_t source, long long now);
+
+private:
+  enum {numOfBuckets = 64}; /**< The size of the table. Must be a power of two. */
+
+  /** The bucket of a source. */
+  struct Bucket
+  {
+    uint32_t source; /**< The address of the sender. */
+    bool used; /**< Has this slot ever been used? */
+    float tokens; /**< The tokens left after the last update. */
+    long long lastUpdate; /**< When the tokens were updated in µs. */
+  };
+
+  float rate; /**< Tokens added per µs. */
+  float burst; /**< The capacity of a bucket. */
+  long long refillTime; /**< The time in µs after which an empty bucket is full again. */
+  Bucket buckets[numOfBuckets];
+};
@@ -0,0 +1,118 @@
+/**
+ * @file ReturnAggregator.cpp
+ * Implements the GameController side of the return packets.
+ */
+
+#include "ReturnAggregator.h"
+#include "UdpComm.h"
+#include "Log.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/filter.h>
+
+static const int UDP_HEADER_SIZE = 8; /**< Socket filters see the UDP header before the payload. */
+
+/**
+ * Attaches a classic BPF program to a socket that only accepts datagrams of
+ * the size of a return packet that start with its header.
+ */
+static bool setFilter(UdpComm& udp)
+{
+  enum {LEN = 0, HEADER = 2, ACCEPT = 4, REJECT = 5};
+  const unsigned char* header = (const unsigned char*) GAMECONTROLLER_RETURN_STRUCT_HEADER;
+  struct sock_filter code[] =
+  {
+    // [LEN]
+    BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, UDP_HEADER_SIZE + sizeof(RoboCupGameControlReturnData), 0, REJECT - LEN - 2),
+    // [HEADER]
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, UDP_HEADER_SIZE + offsetof(RoboCupGameControlReturnData, header)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+             (unsigned) header[0] << 24 | header[1] << 16 | header[2] << 8 | header[3], 0, REJECT - HEADER - 2),
+    // [ACCEPT]
+    BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+    // [REJECT]
+    BPF_STMT(BPF_RET | BPF_K, 0)
+  };
+  return udp.setFilter(code, sizeof(code) / sizeof(code[0]));
+}
+
+ReturnAggregator::ReturnAggregator(int port)
+: udp(new UdpComm()),
+  numOfRequests(0),
+  numOfPackets(0)
+{
+  memset(lastSeen, 0, sizeof(lastSeen));
+  memset(teamsSeen, 0, sizeof(teamsSeen));
+  memset(&drops, 0, sizeof(drops));
+
+  if(!udp->setBlocking(false) || !udp->bind("0.0.0.0", port))
+  {
+    LOG("ReturnAggregator: Could not open UDP port %d", port);
+    delete udp;
+    udp = 0;
+  }
+  else if(!setFilter(*udp))
+    LOG("ReturnAggregator: Could not attach the socket filter");
+}
+
+ReturnAggregator::~ReturnAggregator()
+{
+  delete udp;
+}
+
+int ReturnAggregator::receive(long long now)
+{
+  numOfRequests = 0;
+  if(!udp)
+    return 0;
+
+  // The packets are one byte larger than a return packet, so longer packets are detected.
+  enum {slotSize = sizeof(RoboCupGameControlReturnData) + 1};
+  char packets[maxPacketsPerReceive][slotSize];
+  int sizes[maxPacketsPerReceive];
+  struct sockaddr_in from[maxPacketsPerReceive];
+  const int received = udp->readBatch(packets[0], slotSize, sizes, from, maxPacketsPerReceive);
+  for(int i = 0; i < received; ++i)
+    add(packets[i], sizes[i], from[i].sin_addr.s_addr, now);
+  return received > 0 ? received : 0;
+}
+
+bool ReturnAggregator::add(const char* data, int size, uint32_t address, long long now)
+{
+  RoboCupGameControlReturnData packet;
+  if(size != (int) sizeof(packet))
+  {
+    ++drops.malformed;
+    return false;
+  }
+  memcpy(&packet, data, sizeof(packet));
+  if(memcmp(packet.header, GAMECONTROLLER_RETURN_STRUCT_HEADER, sizeof(packet.header)))
+    ++drops.malformed;
+  else if(packet.version != GAMECONTROLLER_RETURN_STRUCT_VERSION)
+    ++drops.wrongVersion;
+  else if(packet.player < 1 || packet.player > MAX_NUM_PLAYERS)
+    ++drops.invalidPlayer;
+  else if(packet.message > GAMECONTROLLER_RETURN_MSG_ALIVE)
+    ++drops.invalidMessage;
+  else
+  {
+    // Every message shows that the robot is alive.
+    lastSeen[packet.team][packet.player - 1] = now;
+    teamsSeen[packet.team >> 6] |= (uint64_t) 1 << (packet.team & 63);
+    if(packet.message != GAMECONTROLLER_RETURN_MSG_ALIVE && numOfRequests < maxRequests)
+    {
+      Request& request = requests[numOfRequests++];
+      request.team = packet.team;
+      request.player = packet.player;
+      request.message = packet.message;
+      request.address = address;
+      request.timestamp = now;
+    }
+    ++numOfPackets;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file ReturnAggregator.h
+ * Declares the GameController side of the return packets.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "RoboCupGameControlData.h"
+
+class UdpComm;
+
+/**
+ * @class ReturnAggregator
+ * Receives the RoboCupGameControlReturnData of all robots, possibly of
+ * several fields, since team numbers are unique. When each robot was last
+ * heard from is kept in a flat array indexed by team and player number, so
+ * a packet costs a single store and the table (256 teams of
+ * MAX_NUM_PLAYERS) fits into the L1 cache. The manual penalise and
+ * unpenalise requests of a receive() call are handed out right after it.
+ * Packets are read in batches and the kernel drops everything that is not
+ * a return packet, so the GameController packets broadcast on the same port
+ * do not have to be read.
+ */
+class ReturnAggregator
+{
+public:
+  enum {maxTeams = 256}; /**< Team numbers are 8 bits. */
+  enum {maxPacketsPerReceive = 64}; /**< receive() reads at most this many packets per call. */
+  static const long long ALIVE_TIMEOUT = 2000000; /**< Robots not heard from for this many µs are considered gone. Robots send every 500 ms. */
+
+  /** A manual penalise or unpenalise request of a robot. */
+  struct Request
+  {
+    uint8_t team; /**< The team number. */
+    uint8_t player; /**< The player number starting with 1. */
+    uint8_t message; /**< GAMECONTROLLER_RETURN_MSG_MAN_PENALISE or GAMECONTROLLER_RETURN_MSG_MAN_UNPENALISE. */
+    uint32_t address; /**< The IPv4 address of the robot in network byte order. */
+    long long timestamp; /**< When the request was received in µs of the monotonic clock. */
+  };
+
+  /** The numbers of packets not accepted by reason. */
+  struct Drops
+  {
+    unsigned malformed; /**< The size or header was wrong. */
+    unsigned wrongVersion; /**< The version was not GAMECONTROLLER_RETURN_STRUCT_VERSION. */
+    unsigned invalidPlayer; /**< The player number was 0 or above MAX_NUM_PLAYERS. */
+    unsigned invalidMessage; /**< The message was none of the three defined. */
+  };
+
+  /**
+   * Constructor.
+   * @param port The port the return packets are received on.
+   */
+  ReturnAggregator(int port = GAMECONTROLLER_PORT);
+
+  ~ReturnAggregator();
+
+  /** Could the socket be opened? */
+  bool isOpen() const {return udp != 0;}
+
+  /**
+   * Reads the packets received, at most maxPacketsPerReceive.
+   * @param now The current time in µs of the monotonic clock.
+   * @return The number of packets read. If it is maxPacketsPerReceive, more may be waiting.
+   */
+  int receive(long long now);
+
+  /**
+   * Adds a packet. Called by receive() for every packet read.
+   * @param data The packet.
+   * @param size Its size.
+   * @param address The IPv4 address of the sender in network byte order.
+   * @param now When it was received in µs of the monotonic clock.
+   * @return Was the packet accepted?
+   */
+  bool add(const char* data, int size, uint32_t address, long long now);
+
+  /** Returns the number of requests received since the last receive() started. */
+  int getNumOfRequests() const {return numOfRequests;}
+
+  /** Returns a request. The index must be smaller than getNumOfRequests(). */
+  const Request& getRequest(int index) const {return requests[index];}
+
+  /**
+   * Returns when a robot was last heard from.
+   * @param team The team number.
+   * @param player The player number starting with 1.
+   * @return The time in µs of the monotonic clock or 0 if the robot was never heard from.
+   */
+  long long getLastSeen(int team, int player) const
+  {
+    return team >= 0 && team < maxTeams && player >= 1 && player <= MAX_NUM_PLAYERS
+           ? lastSeen[team][player - 1] : 0;
+  }
+
+  /** Was a robot heard from within ALIVE_TIMEOUT? */
+  bool isAlive(int team, int player, long long now) const
+  {
+    const long long seen = getLastSeen(team, player);
+    return seen && now - seen < ALIVE_TIMEOUT;
+  }
+
+  /**
+   * Calls a function for each robot heard from within ALIVE_TIMEOUT. Only
+   * the teams ever heard from are visited.
+   * @param now The current time in µs of the monotonic clock.
+   * @param f A function that accepts (int team, int player, long long lastSeen).
+   */
+  template<typename F> void forEachAlive(long long now, F f) const
+  {
+    for(int word = 0; word < maxTeams / 64; ++word)
+      for(uint64_t bits = teamsSeen[word]; bits; bits &= bits - 1)
+      {
+        const int team = word * 64 + __builtin_ctzll(bits);
+        for(int i = 0; i < MAX_NUM_PLAYERS; ++i)
+          if(lastSeen[team][i] && now - lastSeen[team][i] < ALIVE_TIMEOUT)
+            f(team, i + 1, lastSeen[team][i]);
+      }
+  }
+
+  /** Returns the number of packets accepted. */
+  unsigned getNumOfPackets() const {return numOfPackets;}
+
+  /** Returns the reasons why packets were not accepted. */
+  const Drops& getDrops() const {return drops;}
+
+private:
+  enum {maxRequests = maxPacketsPerReceive}; /**< Every packet of a receive() call can be a request. */
+
+  UdpComm* udp; /**< The socket. 0 if it could not be opened. */
+  long long lastSeen[maxTeams][MAX_NUM_PLAYERS]; /**< When each robot was last heard from in µs. 0 if never. */
+  uint64_t teamsSeen[maxTeams / 64]; /**< Bit i is set if team i was ever heard from. */
+  Request requests[maxRequests]; /**< The requests of the last receive(). */
+  int numOfRequests; /**< The number of requests of the last receive(). */
+  unsigned numOfPackets; /**< The number of packets accepted. */
+  Drops drops; /**< The reasons why packets were not accepted. */
+};
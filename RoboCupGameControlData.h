@@ -67,6 +67,12 @@
 #define PENALTY_SUBSTITUTE                  14
 #define PENALTY_MANUAL                      15
 
+#ifndef __cplusplus
+// allow C code to use the nested structures without the struct keyword
+typedef struct RobotInfo RobotInfo;
+typedef struct TeamInfo TeamInfo;
+#endif
+
 struct RobotInfo
 {
   uint8_t penalty;              // penalty state of the player
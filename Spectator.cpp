@@ -0,0 +1,53 @@
+/**
+ * @file Spectator.cpp
+ * The spectator server. It streams snapshots of the field at
+ * SpectatorServer::FRAME_RATE to everyone subscribed.
+ *
+ * Usage: spectator [--port <port>]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "SpectatorServer.h"
+#include "Log.h"
+
+int main(int argc, char* argv[])
+{
+  int port = SPECTATOR_PORT;
+  for(int i = 1; i < argc; ++i)
+    if(!strcmp(argv[i], "--port") && i + 1 < argc)
+      port = atoi(argv[++i]);
+
+  SpectatorServer server(port);
+  if(!server.isOpen())
+  {
+    Log::flush();
+    return 1;
+  }
+
+  // Frames are sent at fixed moments, so the rate does not depend on the time spent per frame.
+  static const long FRAME_TIME = 1000000000L / SpectatorServer::FRAME_RATE;
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  int subscribers = 0;
+  while(1)
+  {
+    next.tv_nsec += FRAME_TIME;
+    if(next.tv_nsec >= 1000000000L)
+    {
+      next.tv_nsec -= 1000000000L;
+      ++next.tv_sec;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0);
+    const long long now = (long long) next.tv_sec * 1000000 + next.tv_nsec / 1000;
+    server.receive(now);
+    server.tick(now);
+    if(server.getNumOfSubscribers() != subscribers)
+    {
+      subscribers = server.getNumOfSubscribers();
+      LOG("%d subscribers", subscribers);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file SpectatorServer.cpp
+ * Implements a server that aggregates the traffic on a field into
+ * snapshots and streams them to spectators.
+ */
+
+#include "SpectatorServer.h"
+#include "UdpComm.h"
+#include "TeamComm.h"
+#include "DeltaCoding.h"
+#include "Log.h"
+
+#include <string.h>
+#include <utility>
+
+/** Opens a non-blocking socket receiving on a port. Returns 0 on failure. */
+static UdpComm* openSocket(int port)
+{
+  UdpComm* udp = new UdpComm();
+  if(!udp->setBlocking(false) || !udp->bind("0.0.0.0", port))
+  {
+    LOG("SpectatorServer: Could not open UDP port %d", port);
+    delete udp;
+    udp = 0;
+  }
+  return udp;
+}
+
+SpectatorServer::SpectatorServer(int port)
+: gameController(openSocket(GAMECONTROLLER_PORT)),
+  coach(openSocket(SPL_COACH_MESSAGE_PORT)),
+  subscriptions(openSocket(port)),
+  frameNumber(0)
+{
+  teams[0] = teams[1] = 0;
+  teamNumbers[0] = teamNumbers[1] = 0;
+  memset(&snapshot, 0, sizeof(snapshot));
+  memset(&previous, 0, sizeof(previous));
+}
+
+SpectatorServer::~SpectatorServer()
+{
+  delete gameController;
+  delete coach;
+  delete subscriptions;
+  delete teams[0];
+  delete teams[1];
+}
+
+void SpectatorServer::updateTeams()
+{
+  const int numbers[2] = {snapshot.gameControl.teams[0].teamNumber, snapshot.gameControl.teams[1].teamNumber};
+  if(numbers[0] == teamNumbers[1] && numbers[1] == teamNumbers[0])
+  {
+    // The teams changed sides in the packet.
+    std::swap(teams[0], teams[1]);
+    std::swap(teamNumbers[0], teamNumbers[1]);
+  }
+  for(int i = 0; i < 2; ++i)
+    if(numbers[i] != teamNumbers[i])
+    {
+      delete teams[i];
+      teams[i] = numbers[i] ? new TeamComm(numbers[i]) : 0;
+      teamNumbers[i] = numbers[i];
+    }
+}
+
+void SpectatorServer::receive(long long now)
+{
+  RoboCupGameControlData data;
+  int size;
+  while(gameController && (size = gameController->read((char*) &data, sizeof(data))) > 0)
+    if(size == (int) sizeof(data) && !memcmp(data.header, GAMECONTROLLER_STRUCT_HEADER, sizeof(data.header)) &&
+       data.version == GAMECONTROLLER_STRUCT_VERSION)
+    {
+      snapshot.gameControl = data;
+      updateTeams();
+      for(TeamComm* team : teams)
+        if(team)
+          team->update(data, now);
+    }
+
+  SPLCoachMessage message;
+  while(coach && (size = coach->read((char*) &message, sizeof(message))) > 0)
+    if(size == (int) sizeof(message) && !memcmp(message.header, SPL_COACH_MESSAGE_STRUCT_HEADER, sizeof(message.header)) &&
+       message.version == SPL_COACH_MESSAGE_STRUCT_VERSION)
+      for(int i = 0; i < 2; ++i)
+        if(message.team && message.team == snapshot.gameControl.teams[i].teamNumber)
+        {
+          snapshot.coaches[i].sequence = message.sequence;
+          memcpy(snapshot.coaches[i].message, message.message, sizeof(message.message));
+        }
+
+  for(TeamComm* team : teams)
+    if(team)
+      team->receive(now);
+
+  SpectatorFrameHeader header;
+  struct sockaddr_in from;
+  while(subscriptions && (size = subscriptions->read((char*) &header, sizeof(header), &from, 0)) > 0)
+    if(size == (int) sizeof(header) && !memcmp(header.header, SPECTATOR_STRUCT_HEADER, sizeof(header.header)) &&
+       header.version == SPECTATOR_STRUCT_VERSION)
+      subscribe(from, now);
+}
+
+bool SpectatorServer::subscribe(const struct sockaddr_in& address, long long now)
+{
+  for(size_t i = 0; i < addresses.size(); ++i)
+    if(addresses[i].sin_addr.s_addr == address.sin_addr.s_addr && addresses[i].sin_port == address.sin_port)
+    {
+      renewed[i] = now;
+      return true;
+    }
+  if(addresses.size() >= maxSubscribers)
+    return false;
+  addresses.push_back(address);
+  renewed.push_back(now);
+  return true;
+}
+
+void SpectatorServer::expire(long long now)
+{
+  for(size_t i = 0; i < addresses.size();)
+    if(now - renewed[i] >= SUBSCRIPTION_TIMEOUT)
+    {
+      addresses[i] = addresses.back();
+      addresses.pop_back();
+      renewed[i] = renewed.back();
+      renewed.pop_back();
+    }
+    else
+      ++i;
+}
+
+int SpectatorServer::tick(long long now)
+{
+  memset(snapshot.robots, 0, sizeof(snapshot.robots));
+  for(int i = 0; i < 2; ++i)
+    if(teams[i])
+      teams[i]->forEachPlayer(now, [&](const TeamComm::Player& player)
+      {
+        if(player.playerNum < 1 || player.playerNum > MAX_NUM_PLAYERS)
+          return;
+        FieldSnapshot::Robot& robot = snapshot.robots[i][player.playerNum - 1];
+        robot.active = 1;
+        robot.fallen = player.message.fallen;
+        robot.intention = player.message.intention;
+        memcpy(robot.pose, player.message.pose, sizeof(robot.pose));
+        memcpy(robot.ball, player.message.ball, sizeof(robot.ball));
+        robot.ballAge = player.message.ballAge;
+      });
+
+  // Encode the frame once for all subscribers.
+  SpectatorFrameHeader header;
+  memcpy(header.header, SPECTATOR_STRUCT_HEADER, sizeof(header.header));
+  header.version = SPECTATOR_STRUCT_VERSION;
+  header.type = frameNumber % KEYFRAME_INTERVAL ? SPECTATOR_FRAME_DELTA : SPECTATOR_FRAME_KEY;
+  header.padding = 0;
+  header.frameNumber = frameNumber++;
+  frame.assign((const unsigned char*) &header, (const unsigned char*) (&header + 1));
+  if(header.type == SPECTATOR_FRAME_KEY)
+    frame.insert(frame.end(), (const unsigned char*) &snapshot, (const unsigned char*) (&snapshot + 1));
+  else
+    putDelta(frame, (const char*) &snapshot, (const char*) &previous, sizeof(snapshot));
+  previous = snapshot;
+
+  expire(now);
+  if(!subscriptions || addresses.empty())
+    return 0;
+  return subscriptions->writeTo((const char*) frame.data(), (int) frame.size(), addresses.data(), (int) addresses.size());
+}
@@ -0,0 +1,143 @@
+/**
+ * @file SpectatorServer.h
+ * Declares a server that aggregates the traffic on a field into snapshots
+ * and streams them to spectators, e.g. a live visualisation.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <netinet/in.h>
+#include "RoboCupGameControlData.h"
+#include "SPLCoachMessage.h"
+
+class UdpComm;
+class TeamComm;
+
+#define SPECTATOR_PORT           3850
+
+#define SPECTATOR_STRUCT_HEADER  "RSpc"
+#define SPECTATOR_STRUCT_VERSION 1
+
+#define SPECTATOR_FRAME_KEY      0
+#define SPECTATOR_FRAME_DELTA    1
+
+/**
+ * The state of a field at a moment. Frames transport it as a whole
+ * (keyframe) or as the difference to the previous frame (see DeltaCoding.h).
+ */
+struct FieldSnapshot
+{
+  /** What a robot reported in its last message. */
+  struct Robot
+  {
+    uint8_t active;   // 1 if the robot was heard from recently
+    int8_t fallen;
+    int8_t intention;
+    uint8_t padding;
+    float pose[3];    // x, y, theta
+    float ball[2];    // relative to the robot
+    float ballAge;    // s
+  };
+
+  /** The last coach message of a team. */
+  struct Coach
+  {
+    uint8_t sequence;
+    uint8_t message[SPL_COACH_MESSAGE_SIZE];
+  };
+
+  RoboCupGameControlData gameControl; // the last GameController packet
+  Robot robots[2][MAX_NUM_PLAYERS];   // indexed like gameControl.teams and players
+  Coach coaches[2];                   // indexed like gameControl.teams
+};
+
+/**
+ * The header of a frame, followed by the snapshot (SPECTATOR_FRAME_KEY) or
+ * its difference to the snapshot of frame number - 1 (SPECTATOR_FRAME_DELTA).
+ * Spectators subscribe by sending the header alone to SPECTATOR_PORT at
+ * least every SUBSCRIPTION_TIMEOUT.
+ */
+struct SpectatorFrameHeader
+{
+  char header[4];       // SPECTATOR_STRUCT_HEADER
+  uint8_t version;      // SPECTATOR_STRUCT_VERSION
+  uint8_t type;         // SPECTATOR_FRAME_KEY or SPECTATOR_FRAME_DELTA
+  uint16_t padding;
+  uint32_t frameNumber; // increased with each frame
+};
+
+/**
+ * @class SpectatorServer
+ * Receives the GameController packets, the team messages of both teams
+ * playing and the coach messages, and sends a snapshot of the field at a
+ * fixed rate to all subscribers. Each frame is encoded once and the same
+ * bytes are sent to all subscribers in batches, so the cost per
+ * subscriber is only its share of a sendmmsg() call.
+ */
+class SpectatorServer
+{
+public:
+  static const int FRAME_RATE = 60; /**< Frames per second. */
+  static const int KEYFRAME_INTERVAL = 60; /**< Every this many frames a keyframe is sent, so new and lossy subscribers can start. */
+  static const long long SUBSCRIPTION_TIMEOUT = 5000000; /**< Subscribers not renewing for this many µs are removed. */
+  enum {maxSubscribers = 4096}; /**< Further subscriptions are ignored. */
+
+  /**
+   * Constructor.
+   * @param port The port subscriptions are received on and frames are sent from.
+   */
+  SpectatorServer(int port = SPECTATOR_PORT);
+
+  ~SpectatorServer();
+
+  /** Could the sockets be opened? */
+  bool isOpen() const {return subscriptions != 0;}
+
+  /**
+   * Reads all packets received.
+   * @param now The current time in µs of the monotonic clock.
+   */
+  void receive(long long now);
+
+  /**
+   * Builds the snapshot of the field and sends it to all subscribers.
+   * @param now The current time in µs of the monotonic clock.
+   * @return The number of subscribers the frame was sent to.
+   */
+  int tick(long long now);
+
+  /**
+   * Adds a subscriber or renews its subscription.
+   * @param address The address frames are sent to.
+   * @param now The current time in µs of the monotonic clock.
+   * @return Is the subscriber registered?
+   */
+  bool subscribe(const struct sockaddr_in& address, long long now);
+
+  /** Returns the number of subscribers. */
+  int getNumOfSubscribers() const {return (int) addresses.size();}
+
+  /** Returns the size of the last frame sent in bytes. */
+  int getFrameSize() const {return (int) frame.size();}
+
+private:
+  /** Opens the team sockets when the teams playing change. */
+  void updateTeams();
+
+  /** Removes subscribers that did not renew their subscription. */
+  void expire(long long now);
+
+  UdpComm* gameController; /**< Receives the GameController packets. */
+  UdpComm* coach; /**< Receives the coach messages. */
+  UdpComm* subscriptions; /**< Receives subscriptions and sends frames. */
+  TeamComm* teams[2]; /**< Receive the team messages of the teams playing. */
+  int teamNumbers[2]; /**< The team numbers teams were opened for. */
+  FieldSnapshot snapshot; /**< The snapshot being built. */
+  FieldSnapshot previous; /**< The snapshot of the last frame. */
+  uint32_t frameNumber; /**< The number of the next frame. */
+  std::vector<unsigned char> frame; /**< The encoded frame. */
+  std::vector<struct sockaddr_in> addresses; /**< The subscribers. */
+  std::vector<long long> renewed; /**< When each subscriber renewed its subscription in µs. */
+};
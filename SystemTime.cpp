@@ -0,0 +1,22 @@
+/**
+ * @file SystemTime.cpp
+ * Implements the access to the monotonic clock shared by all modules.
+ */
+
+#include "SystemTime.h"
+
+#include <time.h>
+
+long long getMicroseconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+long long getNanoseconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
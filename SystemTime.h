@@ -0,0 +1,12 @@
+/**
+ * @file SystemTime.h
+ * Declares the access to the monotonic clock shared by all modules.
+ */
+
+#pragma once
+
+/** Returns the monotonic time in µs. */
+long long getMicroseconds();
+
+/** Returns the monotonic time in ns. */
+long long getNanoseconds();
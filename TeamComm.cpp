@@ -0,0 +1,165 @@
+/**
+ * @file TeamComm.cpp
+ * Implements the communication with the teammates through SPLStandardMessages.
+ */
+
+#include "TeamComm.h"
+#include "UdpComm.h"
+#include "Log.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <netinet/in.h>
+
+static const int MAX_MESSAGES_PER_RECEIVE = 32; /**< receive() handles at most this many messages per call. */
+static const float MAX_MESSAGE_RATE = 10.f; /**< Messages per second accepted from a single sender in the long run. */
+static const float MAX_MESSAGE_BURST = 20.f; /**< Messages accepted from a single sender in a row. */
+
+TeamComm::TeamComm(int teamNumber)
+: udp(0),
+  teamNumber(teamNumber),
+  port(BASE_PORT + teamNumber),
+  dropIn(false),
+  dropInTeam(0),
+  dropInTime(0),
+  rateLimiter(MAX_MESSAGE_RATE, MAX_MESSAGE_BURST)
+{
+  for(Player& player : players)
+    player.used = false;
+  memset(&drops, 0, sizeof(drops));
+
+  strncpy(broadcastAddress, UdpComm::getWifiBroadcastAddress(), sizeof(broadcastAddress) - 1);
+  broadcastAddress[sizeof(broadcastAddress) - 1] = 0;
+
+  udp = new UdpComm();
+  if(!udp->setBlocking(false) ||
+     !udp->setBroadcast(true) ||
+     !udp->bind("0.0.0.0", port) ||
+     !udp->setTarget(broadcastAddress, port) ||
+     !udp->setLoopback(false))
+  {
+    LOG("TeamComm: Could not open UDP port %d", port);
+    delete udp;
+    udp = 0;
+  }
+}
+
+TeamComm::~TeamComm()
+{
+  if(udp)
+    delete udp;
+}
+
+bool TeamComm::addInterface(const char* name)
+{
+  const char* address = UdpComm::getBroadcastAddress(name);
+  if(!address)
+  {
+    LOG("TeamComm: Cannot send over interface %s", name);
+    return false;
+  }
+  return !udp || !strcmp(address, broadcastAddress) || udp->addTarget(address, port);
+}
+
+bool TeamComm::send(const SPLStandardMessage& message)
+{
+  const int size = (int) (sizeof(message) - SPL_STANDARD_MESSAGE_DATA_SIZE +
+                          (message.numOfDataBytes < SPL_STANDARD_MESSAGE_DATA_SIZE
+                           ? message.numOfDataBytes : SPL_STANDARD_MESSAGE_DATA_SIZE));
+  return !udp || udp->write((const char*) &message, size);
+}
+
+void TeamComm::update(const RoboCupGameControlData& data, long long now)
+{
+  dropIn = data.gameType == GAME_DROPIN;
+  if(data.dropInTime != 0xffff)
+  {
+    dropInTeam = data.dropInTeam;
+    dropInTime = now - data.dropInTime * 1000000LL;
+  }
+}
+
+int TeamComm::receive(long long now)
+{
+  static const int headerSize = (int) offsetof(SPLStandardMessage, data);
+  int accepted = 0;
+  int size;
+  struct sockaddr_in from;
+  SPLStandardMessage message;
+  for(int budget = MAX_MESSAGES_PER_RECEIVE;
+      udp && budget && (size = udp->read((char*) &message, sizeof(message), &from, 0)) > 0; --budget)
+  {
+    const RateLimiter::Result admission = rateLimiter.admit(from.sin_addr.s_addr, now);
+    if(admission == RateLimiter::rateLimited)
+      ++drops.rateLimited;
+    else if(admission == RateLimiter::tableFull)
+      ++drops.tooManySenders;
+    else if(size < headerSize || memcmp(message.header, SPL_STANDARD_MESSAGE_STRUCT_HEADER, sizeof(message.header)) ||
+            message.numOfDataBytes > SPL_STANDARD_MESSAGE_DATA_SIZE || size != headerSize + message.numOfDataBytes)
+      ++drops.malformed;
+    else if(message.version != SPL_STANDARD_MESSAGE_STRUCT_VERSION)
+      ++drops.wrongVersion;
+    else if(!dropIn && message.teamNum != teamNumber)
+      ++drops.otherTeam;
+    else
+    {
+      Player& player = getSlot(message.teamNum, message.playerNum, now);
+      player.lastSeen = now;
+      ++player.numOfMessages;
+      player.size = size;
+      memcpy(&player.message, &message, size);
+      ++accepted;
+    }
+  }
+  return accepted;
+}
+
+TeamComm::Player& TeamComm::getSlot(int teamNum, int playerNum, long long now)
+{
+  Player* free = 0;
+  Player* oldest = 0;
+  unsigned index = getHash(teamNum, playerNum);
+  for(int i = 0; i < numOfPlayers; ++i, index = (index + 1) & (numOfPlayers - 1))
+  {
+    Player& player = players[index];
+    if(player.used && player.teamNum == teamNum && player.playerNum == playerNum)
+    {
+      if(!isAlive(player, now))
+        player.numOfMessages = 0;
+      return player;
+    }
+    else if(!free && !isAlive(player, now))
+      free = &player;
+    if(!player.used)
+      break; // The robot cannot be found behind a slot never used.
+    if(!oldest || player.lastSeen < oldest->lastSeen)
+      oldest = &player;
+  }
+
+  if(!free)
+  {
+    // All slots belong to robots alive.
+    free = oldest;
+    ++drops.evicted;
+  }
+  free->used = true;
+  free->teamNum = (int8_t) teamNum;
+  free->playerNum = (int8_t) playerNum;
+  free->numOfMessages = 0;
+  return *free;
+}
+
+const TeamComm::Player* TeamComm::getPlayer(int teamNum, int playerNum, long long now) const
+{
+  unsigned index = getHash(teamNum, playerNum);
+  for(int i = 0; i < numOfPlayers; ++i, index = (index + 1) & (numOfPlayers - 1))
+  {
+    const Player& player = players[index];
+    if(!player.used)
+      break;
+    if(player.teamNum == teamNum && player.playerNum == playerNum)
+      return isAlive(player, now) ? &player : 0;
+  }
+  return 0;
+}
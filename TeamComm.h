@@ -0,0 +1,160 @@
+/**
+ * @file TeamComm.h
+ * Declares the communication with the teammates through SPLStandardMessages.
+ */
+
+#pragma once
+
+#include <netinet/in.h>
+#include "SPLStandardMessage.h"
+#include "RoboCupGameControlData.h"
+#include "RateLimiter.h"
+
+class UdpComm;
+
+/**
+ * @class TeamComm
+ * Broadcasts SPLStandardMessages to the teammates. If interfaces are added,
+ * each message is mirrored to the broadcast addresses of all of them.
+ *
+ * The last message of each robot heard from is kept in an open-addressing
+ * table keyed by team and player number, so in drop-in games, where the
+ * teammates come from many teams, the robots are found in O(1) without
+ * allocation. Robots not heard from for PLAYER_TIMEOUT are considered gone
+ * and their slots are reused. If the table is full, the robot not heard
+ * from the longest is evicted.
+ */
+class TeamComm
+{
+public:
+  static const int BASE_PORT = 10000; /**< The team port is this plus the team number. */
+  static const long long PLAYER_TIMEOUT = 3000000; /**< Robots not heard from for this many µs are gone. */
+
+  /** A robot messages were received from. */
+  struct Player
+  {
+    bool used; /**< Has this slot ever been used? */
+    int8_t teamNum; /**< The number of the team of the robot. */
+    int8_t playerNum; /**< The player number of the robot. */
+    long long lastSeen; /**< When the last message was received in µs of the monotonic clock. */
+    unsigned numOfMessages; /**< The number of messages received since the robot (re)appeared. */
+    int size; /**< The number of bytes of the last message. */
+    SPLStandardMessage message; /**< The last message. The data beyond numOfDataBytes is undefined. */
+  };
+
+  /** The numbers of messages not accepted by reason. */
+  struct Drops
+  {
+    unsigned rateLimited; /**< The sender exceeded its rate. */
+    unsigned tooManySenders; /**< The rate limiter could not track the sender. */
+    unsigned malformed; /**< The size, header or number of data bytes was wrong. */
+    unsigned wrongVersion; /**< The version was not SPL_STANDARD_MESSAGE_STRUCT_VERSION. */
+    unsigned otherTeam; /**< The message was from another team outside of drop-in games. */
+    unsigned evicted; /**< Robots removed from the full table while still alive. */
+  };
+
+  /**
+   * Constructor.
+   * @param teamNumber The number of the team. It determines the port used.
+   */
+  TeamComm(int teamNumber);
+
+  /**
+   * Destructor.
+   */
+  ~TeamComm();
+
+  /**
+   * Adds an interface messages are sent over. Before it is called, messages
+   * are only sent over the wifi interface.
+   * @param name The name of the interface, e.g. "eth0".
+   * @return Was the interface found?
+   */
+  bool addInterface(const char* name);
+
+  /**
+   * Sends a message to the teammates. Only the part of the data array
+   * actually used is sent.
+   * @param message The message.
+   * @return Was the message sent over at least one path?
+   */
+  bool send(const SPLStandardMessage& message);
+
+  /**
+   * Selects whether messages from robots of other teams are accepted, as
+   * in GAME_DROPIN games. By default, only messages of the own team are.
+   */
+  void setDropIn(bool dropIn) {this->dropIn = dropIn;}
+
+  /**
+   * Adapts to the game: drop-in mode is selected if the game type is
+   * GAME_DROPIN, and the last drop-in is remembered.
+   * @param data A packet accepted from the GameController.
+   * @param now When it was received in µs of the monotonic clock.
+   */
+  void update(const RoboCupGameControlData& data, long long now);
+
+  /** Returns the number of the team that caused the last drop-in. 0 before the first. */
+  int getDropInTeam() const {return dropInTeam;}
+
+  /** Returns when the last drop-in happened in µs of the monotonic clock. 0 before the first. */
+  long long getDropInTime() const {return dropInTime;}
+
+  /**
+   * Reads the messages received.
+   * @param now The current time in µs of the monotonic clock.
+   * @return The number of messages accepted.
+   */
+  int receive(long long now);
+
+  /**
+   * Returns the last message of a robot.
+   * @param teamNum The number of its team.
+   * @param playerNum Its player number.
+   * @param now The current time in µs of the monotonic clock.
+   * @return The robot or 0 if it was not heard from within PLAYER_TIMEOUT.
+   */
+  const Player* getPlayer(int teamNum, int playerNum, long long now) const;
+
+  /**
+   * Calls a function for each robot heard from within PLAYER_TIMEOUT.
+   * @param now The current time in µs of the monotonic clock.
+   * @param f A function that accepts (const Player&).
+   */
+  template<typename F> void forEachPlayer(long long now, F f) const
+  {
+    for(const Player& player : players)
+      if(isAlive(player, now))
+        f(player);
+  }
+
+  /** Returns the reasons why messages were not accepted. */
+  const Drops& getDrops() const {return drops;}
+
+  UdpComm* udp; /**< The socket used to communicate. 0 if it could not be opened. */
+
+private:
+  enum {numOfPlayers = 64}; /**< The size of the table. Must be a power of two. */
+
+  /** Was a robot heard from within PLAYER_TIMEOUT? */
+  static bool isAlive(const Player& player, long long now) {return player.used && now - player.lastSeen < PLAYER_TIMEOUT;}
+
+  /** Returns the first slot to probe for a robot. */
+  static unsigned getHash(int teamNum, int playerNum)
+  {
+    return ((unsigned) (uint8_t) teamNum << 8 | (uint8_t) playerNum) * 2654435761u >> 26; // Fibonacci hashing to 6 bits
+  }
+
+  /** Returns the slot of a robot, reusing or evicting another one if it is not in the table. */
+  Player& getSlot(int teamNum, int playerNum, long long now);
+
+  int teamNumber; /**< The number of the own team. */
+  int port; /**< The team port. */
+  bool dropIn; /**< Are messages from other teams accepted? */
+  int dropInTeam; /**< The team that caused the last drop-in. 0 before the first. */
+  long long dropInTime; /**< When the last drop-in happened in µs of the monotonic clock. 0 before the first. */
+  RateLimiter rateLimiter; /**< Limits the message rate per sender. */
+  Player players[numOfPlayers]; /**< The robots heard from. */
+  Drops drops; /**< The reasons why messages were not accepted. */
+  char broadcastAddress[INET_ADDRSTRLEN]; /**< The default target. */
+};
@@ -0,0 +1,35 @@
+/**
+ * @file Test.h
+ * Declares the checks used by the test programs run by "make test". Each
+ * test program checks one component and returns 0 if all checks passed.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+/** The number of checks that failed in this test program. */
+inline int numOfFailedChecks = 0;
+
+/** Reports a failed check with its location and continues. */
+#define CHECK(condition) \
+  do \
+  { \
+    if(!(condition)) \
+    { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      ++numOfFailedChecks; \
+    } \
+  } \
+  while(false)
+
+/**
+ * Reports the result of a test program.
+ * @param name The name of the component tested.
+ * @return The exit code of the test program.
+ */
+inline int reportTest(const char* name)
+{
+  printf("%-32s %s\n", name, numOfFailedChecks ? "FAILED" : "passed");
+  return numOfFailedChecks ? 1 : 0;
+}
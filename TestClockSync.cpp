@@ -0,0 +1,109 @@
+/**
+ * @file TestClockSync.cpp
+ * Checks the estimates of ClockSync against a host with a known offset and
+ * drift. Both run on a simulated clock, so the delays of the link are
+ * exactly known.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "ClockSync.h"
+#include "LocalTransport.h"
+#include "Test.h"
+
+static const long long OFFSET = 1500000000000LL; /**< The host clock is ahead by this many µs. */
+static const int INTERVAL = 250; /**< The time between requests in ms. */
+
+static long long now = 1000000; /**< The simulated local time in µs. */
+static double drift = 0.0; /**< The drift of the host clock in µs per µs. */
+
+/** The simulated host clock. */
+static long long getHostTime()
+{
+  return now + OFFSET + (long long) (now * drift);
+}
+
+/**
+ * Runs request and response cycles.
+ * @param sync The client.
+ * @param server The host.
+ * @param duration For how long in µs.
+ * @param roundTrip The round trip time in µs. It is the same for all requests.
+ * @param jitter The maximum difference of the delays of a request and its response in µs.
+ */
+static void run(ClockSync& sync, ClockSyncServer& server, long long duration, int roundTrip, int jitter)
+{
+  const long long end = now + duration;
+  while(now < end)
+  {
+    const int delay = roundTrip / 2 + (jitter ? rand() % (2 * jitter + 1) - jitter : 0) / 2;
+    sync.update();
+    now += delay;
+    server.update();
+    now += roundTrip - delay;
+    sync.update();
+    now += INTERVAL * 1000 - roundTrip;
+  }
+}
+
+/** The error of the estimated host time now in µs. */
+static long long getError(const ClockSync& sync)
+{
+  return llabs(sync.toHostTime(now) - getHostTime());
+}
+
+int main()
+{
+  srand(42);
+  const Clock clock = [] {return now;};
+
+  // Without drift and jitter, the offset is exact.
+  {
+    LocalTransport client, host;
+    LocalTransport::connect(client, host);
+    ClockSync sync(client, 1, 1, INTERVAL, clock);
+    ClockSyncServer server(host, getHostTime);
+    CHECK(!sync.isSynchronized());
+    run(sync, server, 2000000, 4000, 0);
+    CHECK(sync.isSynchronized());
+    CHECK(getError(sync) <= 1);
+    CHECK(sync.getRoundTrip() == 4000);
+  }
+
+  // A drift of +100 ppm is not estimated from a few seconds, but the offset is still close.
+  drift = 100e-6;
+  {
+    LocalTransport client, host;
+    LocalTransport::connect(client, host);
+    ClockSync sync(client, 1, 1, INTERVAL, clock);
+    ClockSyncServer server(host, getHostTime);
+    run(sync, server, 10000000, 4000, 100);
+    CHECK(!sync.isDriftEstimated());
+    CHECK(sync.getDrift() == 0.0);
+    CHECK(getError(sync) < 1500); // the best sample may be 10 s old
+
+    // After a minute, the drift is estimated with the right sign and size.
+    run(sync, server, 60000000, 4000, 500);
+    CHECK(sync.isDriftEstimated());
+    CHECK(fabs(sync.getDrift() - 100.0) < 5.0);
+    CHECK(getError(sync) < 300);
+
+    // Converting a time 10 s in the future uses the drift.
+    const long long later = now + 10000000;
+    const long long expected = later + OFFSET + (long long) (later * drift);
+    CHECK(llabs(sync.toHostTime(later) - expected) < 300);
+  }
+
+  // If the offsets are too noisy, no drift is assumed instead of a wrong one.
+  {
+    LocalTransport client, host;
+    LocalTransport::connect(client, host);
+    ClockSync sync(client, 1, 1, INTERVAL, clock);
+    ClockSyncServer server(host, getHostTime);
+    run(sync, server, 70000000, 40000, 39000);
+    CHECK(!sync.isDriftEstimated());
+    CHECK(sync.getDrift() == 0.0);
+  }
+
+  return reportTest("ClockSync");
+}
@@ -0,0 +1,97 @@
+/**
+ * @file TestGameClock.cpp
+ * Checks that the game clock extrapolates running times between packets,
+ * stops them at zero and at pauses, and that a reader never sees a torn
+ * update while another thread writes.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "GameClock.h"
+#include "Test.h"
+
+static const long long SECOND = 1000000; /**< One second in µs. */
+static const int TEAM = 2; /**< The number of our team. */
+static const int PLAYER = 3; /**< The number of this robot. */
+static const int CYCLES = 500000; /**< The number of times the writer starts and stops the times while reading. */
+
+/** A packet in which all three times have the same value. */
+static RoboCupGameControlData packet(int value)
+{
+  RoboCupGameControlData data;
+  memset(&data, 0, sizeof(data));
+  data.secsRemaining = (uint16_t) value;
+  data.secondaryTime = (uint16_t) value;
+  data.teams[0].teamNumber = TEAM;
+  data.teams[0].players[PLAYER - 1].secsTillUnpenalised = (uint8_t) value;
+  return data;
+}
+
+int main()
+{
+  // A time that did not decrease yet is reported as sent.
+  {
+    GameClock clock;
+    clock.update(packet(60), TEAM, PLAYER, 0);
+    CHECK(!clock.isRunning(GameClock::secsRemaining));
+    CHECK(clock.get(GameClock::secsRemaining, SECOND / 2) == 60.f);
+
+    // After it decreased, it runs between packets. Both windows end at 61 s.
+    clock.update(packet(59), TEAM, PLAYER, SECOND);
+    CHECK(clock.isRunning(GameClock::secsRemaining));
+    CHECK(clock.isRunning(GameClock::secsTillUnpenalised));
+    const float early = clock.get(GameClock::secsRemaining, SECOND + SECOND / 4);
+    const float late = clock.get(GameClock::secsRemaining, SECOND + 3 * SECOND / 4);
+    CHECK(fabsf(early - 59.25f) < 0.01f);
+    CHECK(fabsf(early - late - 0.5f) < 0.01f);
+
+    // It stops at zero.
+    CHECK(clock.get(GameClock::secsRemaining, 100 * SECOND) == 0.f);
+
+    // A value that stays the same for longer than a second is a pause.
+    clock.update(packet(58), TEAM, PLAYER, 2 * SECOND);
+    CHECK(clock.isRunning(GameClock::secsRemaining));
+    clock.update(packet(58), TEAM, PLAYER, 3 * SECOND + SECOND / 2);
+    CHECK(!clock.isRunning(GameClock::secsRemaining));
+    CHECK(clock.get(GameClock::secsRemaining, 10 * SECOND) == 58.f);
+  }
+
+  // A reader never sees the deadline of one update with the running state
+  // of another. The writer alternates between 200 stopped and 199 running
+  // one second later. The running deadline jumps between 200.5 s and
+  // 210.5 s, so each stop contradicts the previous run. Read at 1 s, a
+  // stopped time is 200 and a running one 199.5 or 209.5. A torn read
+  // gives 199, 200.5 or 210.5.
+  {
+    static GameClock clock;
+    clock.update(packet(200), TEAM, PLAYER, 0);
+    std::atomic<bool> done(false);
+    std::thread writer([&]
+    {
+      for(int i = 0; i < CYCLES; ++i)
+      {
+        const long long start = i & 1 ? 10 * SECOND : 0;
+        const long long next = i & 1 ? 0 : 10 * SECOND;
+        clock.update(packet(199), TEAM, PLAYER, start + SECOND);
+        clock.update(packet(200), TEAM, PLAYER, next);
+      }
+      done = true;
+    });
+
+    int torn = 0, reads = 0;
+    while(!done)
+      for(int time = 0; time < GameClock::numOfTimes; ++time, ++reads)
+      {
+        const float value = clock.get((GameClock::Time) time, SECOND);
+        if(fabsf(value - 200.f) > 0.01f && fabsf(value - 199.5f) > 0.01f && fabsf(value - 209.5f) > 0.01f)
+          ++torn;
+      }
+    writer.join();
+    CHECK(reads > 0);
+    CHECK(!torn);
+  }
+
+  return reportTest("GameClock");
+}
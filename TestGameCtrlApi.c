@@ -0,0 +1,142 @@
+/**
+ * @file TestGameCtrlApi.c
+ * Checks the C interface of libgamectrl from a C program, linked once
+ * against the static and once against the shared library. A packet is sent
+ * to GAMECONTROLLER_PORT through the loopback interface.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "GameCtrlApi.h"
+
+#ifndef LINKAGE
+#define LINKAGE "static"
+#endif
+
+#define OWN 2 /* the number of our team */
+#define PLAYER 3 /* the number of this robot */
+
+static int numOfFailedChecks = 0;
+
+/* Reports a failed check with its location and continues. */
+#define CHECK(condition) \
+  do \
+  { \
+    if(!(condition)) \
+    { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      ++numOfFailedChecks; \
+    } \
+  } \
+  while(0)
+
+/* What the callback was called with. */
+struct Calls
+{
+  int count;
+  unsigned changes;
+  const struct RoboCupGameControlData* data;
+};
+
+static void callback(const struct RoboCupGameControlData* data, unsigned changes, void* context)
+{
+  struct Calls* calls = (struct Calls*) context;
+  ++calls->count;
+  calls->changes = changes;
+  calls->data = data;
+}
+
+/* Sends a packet that sets the penalty of this robot. */
+static int sendPacket(uint8_t packetNumber, uint8_t penalty)
+{
+  struct RoboCupGameControlData data;
+  struct sockaddr_in address;
+  int sent;
+  const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sock == -1)
+    return 0;
+  memset(&data, 0, sizeof(data));
+  memcpy(data.header, GAMECONTROLLER_STRUCT_HEADER, sizeof(data.header));
+  data.version = GAMECONTROLLER_STRUCT_VERSION;
+  data.packetNumber = packetNumber;
+  data.state = STATE_PLAYING;
+  data.teams[0].teamNumber = OWN;
+  data.teams[1].teamNumber = 7;
+  data.teams[1].teamColour = TEAM_RED;
+  data.teams[0].players[PLAYER - 1].penalty = penalty;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(GAMECONTROLLER_PORT);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sent = (int) sendto(sock, &data, sizeof(data), 0, (struct sockaddr*) &address, sizeof(address));
+  close(sock);
+  return sent == (int) sizeof(data);
+}
+
+int main(void)
+{
+  struct Calls calls;
+  unsigned chest, leftFoot, rightFoot, changes;
+  int id;
+  gamectrl* handle;
+
+  CHECK(gamectrl_api_version() == GAMECTRL_API_VERSION);
+  handle = gamectrl_create(OWN, PLAYER);
+  CHECK(handle);
+  if(!handle)
+  {
+    printf("%-32s FAILED\n", "GameCtrlApi (" LINKAGE ")");
+    return 1;
+  }
+
+  /* Nothing was received yet. */
+  CHECK(!gamectrl_is_connected(handle));
+  CHECK(gamectrl_get_data(handle)->packetNumber == 0);
+  CHECK(gamectrl_get_penalty(handle) == PENALTY_NONE);
+  CHECK(!gamectrl_get_penalty_start(handle));
+
+  memset(&calls, 0, sizeof(calls));
+  id = gamectrl_add_callback(handle, GAMECTRL_CHANGED_PENALTY, callback, &calls);
+  CHECK(id >= 0);
+
+  /* A packet changes the state, the teams, the penalty and the LEDs. */
+  CHECK(sendPacket(5, PENALTY_SPL_PLAYER_PUSHING));
+  CHECK(gamectrl_wait(handle, 1000));
+  changes = gamectrl_update(handle);
+  CHECK(changes & GAMECTRL_CHANGED_PACKET);
+  CHECK(changes & GAMECTRL_CHANGED_STATE);
+  CHECK(changes & GAMECTRL_CHANGED_TEAMS);
+  CHECK(changes & GAMECTRL_CHANGED_PENALTY);
+  CHECK(changes & GAMECTRL_CHANGED_LEDS);
+  CHECK(changes & GAMECTRL_CHANGED_CONNECTION);
+  CHECK(calls.count == 1 && calls.changes == changes && calls.data == gamectrl_get_data(handle));
+
+  CHECK(gamectrl_is_connected(handle));
+  CHECK(gamectrl_get_data(handle)->packetNumber == 5);
+  CHECK(gamectrl_get_penalty(handle) == PENALTY_SPL_PLAYER_PUSHING);
+  CHECK(gamectrl_get_penalty_start(handle) > 0);
+  gamectrl_get_leds(handle, &chest, &leftFoot, &rightFoot);
+  CHECK(chest != 0);
+
+  /* Without another packet, nothing changes. */
+  CHECK(!gamectrl_update(handle));
+  CHECK(calls.count == 1);
+
+  /* A removed callback is not called anymore. */
+  gamectrl_remove_callback(handle, id);
+  CHECK(sendPacket(6, PENALTY_NONE));
+  CHECK(gamectrl_wait(handle, 1000));
+  CHECK(gamectrl_update(handle) & GAMECTRL_CHANGED_PENALTY);
+  CHECK(calls.count == 1);
+  CHECK(gamectrl_get_penalty(handle) == PENALTY_NONE);
+  CHECK(!gamectrl_get_penalty_start(handle));
+
+  gamectrl_destroy(handle);
+
+  printf("%-32s %s\n", "GameCtrlApi (" LINKAGE ")", numOfFailedChecks ? "FAILED" : "passed");
+  return numOfFailedChecks ? 1 : 0;
+}
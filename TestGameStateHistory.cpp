@@ -0,0 +1,92 @@
+/**
+ * @file TestGameStateHistory.cpp
+ * Checks that the history extends packet numbers, ignores duplicates and
+ * old packets and that its lookups return the right versions.
+ */
+
+#include <string.h>
+#include "GameStateHistory.h"
+#include "Test.h"
+
+static const int NUM_OF_PACKETS = 300; /**< More than the capacity, so the packet numbers wrap around. */
+static const int LOST = 10; /**< Every 10th packet is lost. */
+static const int PLAYING = 280; /**< The packet from which on the game is playing. */
+static const long long INTERVAL = 500000; /**< The time between packets in µs. */
+
+/** The packet i. */
+static RoboCupGameControlData packet(int i)
+{
+  RoboCupGameControlData data;
+  memset(&data, 0, sizeof(data));
+  data.packetNumber = (uint8_t) i;
+  data.state = i >= PLAYING ? STATE_PLAYING : STATE_READY;
+  data.secsRemaining = (uint16_t) i;
+  return data;
+}
+
+int main()
+{
+  static GameStateHistory history;
+  CHECK(history.getSnapshot().size() == 0);
+
+  for(int i = 0; i < NUM_OF_PACKETS; ++i)
+    if(i % LOST != LOST / 2)
+      CHECK(history.add(packet(i), i * INTERVAL));
+
+  // Duplicates and older packets are ignored.
+  const long long last = (NUM_OF_PACKETS - 1) * INTERVAL;
+  CHECK(!history.add(packet(NUM_OF_PACKETS - 1), last + 1000));
+  CHECK(!history.add(packet(NUM_OF_PACKETS - 2), last + 2000));
+
+  GameStateHistory::Snapshot snapshot = history.getSnapshot();
+  CHECK(snapshot.size() == GameStateHistory::capacity - GameStateHistory::margin);
+  CHECK(snapshot[0].sequence == NUM_OF_PACKETS - 1);
+  CHECK(snapshot[0].secsRemaining == NUM_OF_PACKETS - 1);
+  CHECK(snapshot[1].sequence == NUM_OF_PACKETS - 2);
+
+  // Sequence numbers continue beyond 255 and lost packets are not found.
+  const GameState* state = snapshot.findBySequence(260);
+  CHECK(state && state->secsRemaining == 260 && state->packetNumber == 4);
+  CHECK(!snapshot.findBySequence(255));
+  CHECK(!snapshot.findBySequence(NUM_OF_PACKETS));
+  CHECK(!snapshot.findBySequence(1));
+
+  // The version current at a time is the last one received before.
+  state = snapshot.findByTime(200 * INTERVAL + 1);
+  CHECK(state && state->sequence == 200);
+  state = snapshot.findByTime(255 * INTERVAL + 1);
+  CHECK(state && state->sequence == 254);
+  CHECK(!snapshot.findByTime(INTERVAL));
+
+  // The run of versions in which the game is playing.
+  state = snapshot.since([](const GameState& s) {return s.state == STATE_PLAYING;});
+  CHECK(state && state->sequence == PLAYING);
+  CHECK(!snapshot.since([](const GameState& s) {return s.state == STATE_READY;}));
+  CHECK(snapshot.isValid());
+  CHECK(history.getStartOf([](const GameState& s) {return s.state == STATE_PLAYING;}) == PLAYING * INTERVAL);
+
+  // If the writer overtakes a reader, the result is discarded. Here the
+  // writer adds more than the margin while the condition is evaluated.
+  bool overtaken = false;
+  CHECK(!history.getStartOf([&](const GameState& s)
+  {
+    for(int i = NUM_OF_PACKETS; !overtaken && i <= NUM_OF_PACKETS + GameStateHistory::margin; ++i)
+      history.add(packet(i), i * INTERVAL);
+    overtaken = true;
+    return s.state == STATE_PLAYING;
+  }));
+
+  // An older packet number after a pause is a restarted GameController.
+  const long long newest = (NUM_OF_PACKETS + GameStateHistory::margin) * INTERVAL;
+  CHECK(history.add(packet(3), newest + 2000000));
+  snapshot = history.getSnapshot();
+  CHECK(snapshot[0].packetNumber == 3 && snapshot[0].sequence > NUM_OF_PACKETS);
+
+  // Adding more than the margin invalidates an old snapshot.
+  GameStateHistory::Snapshot old = history.getSnapshot();
+  for(int i = 4; i < 4 + GameStateHistory::margin + 1; ++i)
+    history.add(packet(i), newest + 2000000 + i * INTERVAL);
+  CHECK(!old.isValid());
+
+  return reportTest("GameStateHistory");
+}
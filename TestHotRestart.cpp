@@ -0,0 +1,146 @@
+/**
+ * @file TestHotRestart.cpp
+ * Checks that a running process hands its socket and state over to a
+ * successor process, that a packet waiting in the socket's queue is not
+ * lost, and that processes of other users do not get the socket.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "HotRestart.h"
+#include "SystemTime.h"
+#include "Test.h"
+
+static const int PORT = 38399; /**< Names the segment and the Unix socket, so it must not be used by a.out. */
+static const int OTHER_USER = 65534; /**< The user "nobody". */
+
+/** Waits until a byte can be read from a pipe. */
+static void waitFor(int pipe)
+{
+  char byte;
+  while(read(pipe, &byte, 1) == -1 && errno == EINTR)
+    ;
+}
+
+/**
+ * The successor. It takes over the socket and reads the state and the
+ * packet queued.
+ * @return The exit code: 0 if everything was received.
+ */
+static int succeed(int ready, int bound)
+{
+  waitFor(ready);
+  HotRestart successor(PORT);
+  const int socket = successor.takeOver(2000);
+  int failures = 0;
+  struct sockaddr_in address;
+  socklen_t length = sizeof(address);
+  if(socket == -1 || getsockname(socket, (struct sockaddr*) &address, &length) == -1 ||
+     ntohs(address.sin_port) != bound)
+    ++failures;
+  char packet[16] = {0};
+  if(socket == -1 || recv(socket, packet, sizeof(packet), MSG_DONTWAIT) != 4 || memcmp(packet, "ping", 4))
+    ++failures;
+  PersistedState state;
+  if(!successor.load(state, 10000) || state.teamNumber != 2 || state.data.packetNumber != 42)
+    ++failures;
+  return failures;
+}
+
+/**
+ * A process of another user trying to take over.
+ * @return The exit code: 0 if it did not get the socket.
+ */
+static int intrude(int ready)
+{
+  waitFor(ready);
+  if(setuid(OTHER_USER) == -1)
+    return 1;
+  HotRestart intruder(PORT);
+  return intruder.takeOver(500) == -1 ? 0 : 1;
+}
+
+/** Starts a child process that waits for the pipe before it runs. */
+template<typename Function> static pid_t start(int& ready, Function function)
+{
+  int fds[2];
+  if(pipe(fds) == -1)
+    return -1;
+  const pid_t pid = fork();
+  if(!pid)
+  {
+    close(fds[1]);
+    _exit(function(fds[0]));
+  }
+  close(fds[0]);
+  ready = fds[1];
+  return pid;
+}
+
+/** Lets a child run and returns its exit code. */
+static int finish(pid_t pid, int ready)
+{
+  int status = 0;
+  if(write(ready, "", 1) != 1 || waitpid(pid, &status, 0) != pid)
+    return -1;
+  close(ready);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+int main()
+{
+  // Fork before the threads are started.
+  const int socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  CHECK(socket != -1 && bind(socket, (struct sockaddr*) &address, sizeof(address)) != -1 &&
+        getsockname(socket, (struct sockaddr*) &address, &length) != -1);
+  const int bound = ntohs(address.sin_port);
+  int intruderReady = -1, successorReady = -1;
+  const pid_t intruder = getuid() ? -1 : start(intruderReady, intrude);
+  const pid_t successor = start(successorReady, [bound](int ready) {return succeed(ready, bound);});
+
+  {
+    HotRestart predecessor(PORT);
+    PersistedState state;
+    memset(&state, 0, sizeof(state));
+    state.data.packetNumber = 42;
+    state.teamNumber = 2;
+    state.whenReceived = getMicroseconds();
+    {
+      std::lock_guard<std::mutex> lock(predecessor.getMutex());
+      predecessor.save(state);
+    }
+    CHECK(predecessor.listen(socket));
+
+    // A packet waiting in the queue during the hand-over.
+    const int sender = ::socket(AF_INET, SOCK_DGRAM, 0);
+    CHECK(sendto(sender, "ping", 4, 0, (struct sockaddr*) &address, sizeof(address)) == 4);
+    close(sender);
+
+    // Only root can run a process of another user.
+    if(intruder != -1)
+    {
+      CHECK(finish(intruder, intruderReady) == 0);
+      CHECK(!predecessor.isHandedOff());
+    }
+
+    CHECK(finish(successor, successorReady) == 0);
+    for(int i = 0; i < 100 && !predecessor.isHandedOff(); ++i)
+      usleep(10000);
+    CHECK(predecessor.isHandedOff());
+
+    // This process cannot read from its socket number anymore.
+    char packet[16];
+    CHECK(recv(socket, packet, sizeof(packet), MSG_DONTWAIT) == -1);
+  }
+
+  return reportTest("HotRestart");
+}
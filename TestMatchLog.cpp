@@ -0,0 +1,127 @@
+/**
+ * @file TestMatchLog.cpp
+ * Checks that deltas and match logs reproduce what was written.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "DeltaCoding.h"
+#include "MatchLog.h"
+#include "Test.h"
+
+/** Checks that a buffer is restored from its delta to a base. */
+static void checkDelta(const char* data, const char* base, int size)
+{
+  std::vector<unsigned char> delta;
+  putDelta(delta, data, base, size);
+  std::vector<char> restored(base, base + size);
+  const unsigned char* p = delta.data();
+  CHECK(getDelta(p, delta.data() + delta.size(), restored.data(), size));
+  CHECK(p == delta.data() + delta.size());
+  CHECK(!memcmp(restored.data(), data, size));
+}
+
+int main()
+{
+  // Varints of all lengths.
+  static const uint64_t values[] = {0, 1, 127, 128, 16383, 16384, 0xffffffffull, 0xffffffffffffffffull};
+  std::vector<unsigned char> out;
+  for(uint64_t value : values)
+    putVarint(out, value);
+  const unsigned char* p = out.data();
+  for(uint64_t value : values)
+  {
+    uint64_t read = 0;
+    CHECK(getVarint(p, out.data() + out.size(), read) && read == value);
+  }
+  CHECK(p == out.data() + out.size());
+  uint64_t truncated;
+  p = out.data();
+  CHECK(!getVarint(p, out.data(), truncated));
+
+  // Deltas: equal, single bytes at both ends, isolated zeros, random.
+  char base[256], data[256];
+  memset(base, 0, sizeof(base));
+  memset(data, 0, sizeof(data));
+  checkDelta(data, base, sizeof(data));
+  data[0] = 1;
+  data[255] = 2;
+  checkDelta(data, base, sizeof(data));
+  data[2] = 3;
+  data[100] = 4;
+  data[102] = 5;
+  checkDelta(data, base, sizeof(data));
+  srand(42);
+  for(int i = 0; i < 100; ++i)
+  {
+    for(int j = 0; j < (int) sizeof(data); ++j)
+    {
+      base[j] = (char) rand();
+      data[j] = rand() % 4 ? base[j] : (char) rand();
+    }
+    checkDelta(data, base, sizeof(data));
+  }
+
+  // A match log spanning several blocks with both types of records. It has
+  // more blocks than there are between two resync points.
+  std::vector<MatchLogEntry> entries;
+  MatchLogEntry entry;
+  RoboCupGameControlData gameControl;
+  memset(&gameControl, 0, sizeof(gameControl));
+  memcpy(gameControl.header, GAMECONTROLLER_STRUCT_HEADER, sizeof(gameControl.header));
+  gameControl.version = GAMECONTROLLER_STRUCT_VERSION;
+  gameControl.teams[0].teamNumber = 2;
+  gameControl.teams[1].teamNumber = 7;
+  SPLStandardMessage message;
+  long long timestamp = 1000000;
+  for(int i = 0; i < 1000; ++i)
+  {
+    timestamp += rand() % 300000;
+    if(i % 3)
+    {
+      ++gameControl.packetNumber;
+      gameControl.secsRemaining = (uint16_t) (600 - i);
+      gameControl.teams[i % 2].score = (uint8_t) (i / 50);
+      entry.type = MatchLogEntry::gameControlData;
+      entry.size = sizeof(gameControl);
+      entry.gameControl = gameControl;
+    }
+    else
+    {
+      message.teamNum = (int8_t) (i % 2 ? 2 : 7);
+      message.playerNum = (int8_t) (i % 5 + 1);
+      message.pose[0] = (float) (rand() % 1000);
+      message.numOfDataBytes = (uint16_t) (i % 40);
+      memset(message.data, i, message.numOfDataBytes);
+      entry.type = MatchLogEntry::teamMessage;
+      entry.size = (int) offsetof(SPLStandardMessage, data) + message.numOfDataBytes;
+      memcpy(entry.data, &message, entry.size);
+    }
+    entry.timestamp = timestamp;
+    entries.push_back(entry);
+  }
+
+  static const char* path = "/tmp/test.matchlog";
+  MatchLogWriter writer(path, 16);
+  CHECK(writer.isOpen());
+  for(const MatchLogEntry& e : entries)
+    if(e.type == MatchLogEntry::gameControlData)
+      writer.write(e.gameControl, e.timestamp);
+    else
+      writer.write(e.getTeamMessage(), e.size, e.timestamp);
+  writer.close();
+
+  MatchLogReader reader(path);
+  CHECK(reader.isOpen());
+  size_t count = 0;
+  for(; reader.read(entry); ++count)
+    CHECK(count < entries.size() && entry.type == entries[count].type &&
+          entry.timestamp == entries[count].timestamp && entry.size == entries[count].size &&
+          !memcmp(entry.data, entries[count].data, entry.size));
+  CHECK(count == entries.size());
+  remove(path);
+
+  return reportTest("MatchLog");
+}
@@ -0,0 +1,109 @@
+/**
+ * @file TestPenaltyShootout.cpp
+ * Checks that the shootout tracker scores goals and misses, alternates the
+ * shooters and reports the events of each packet.
+ */
+
+#include <string.h>
+#include "PenaltyShootout.h"
+#include "Test.h"
+
+static const int OWN = 2; /**< The number of our team. */
+static const int OPPONENT = 5; /**< The number of the other team. */
+
+/** A packet of a shootout in which teams[1] is our team. */
+static RoboCupGameControlData packet(int kickOffTeam, int ownShots, int ownGoals, int opponentShots, int opponentGoals)
+{
+  RoboCupGameControlData data;
+  memset(&data, 0, sizeof(data));
+  data.state = STATE_SET;
+  data.secondaryState = STATE2_PENALTYSHOOT;
+  data.kickOffTeam = (uint8_t) kickOffTeam;
+  data.teams[0].teamNumber = OPPONENT;
+  data.teams[0].penaltyShot = (uint8_t) opponentShots;
+  data.teams[0].singleShots = (uint16_t) opponentGoals;
+  data.teams[1].teamNumber = OWN;
+  data.teams[1].penaltyShot = (uint8_t) ownShots;
+  data.teams[1].singleShots = (uint16_t) ownGoals;
+  return data;
+}
+
+/** Was an event reported by the last update? */
+static bool hasEvent(const PenaltyShootout& shootout, int numOfEvents, PenaltyShootout::Event::Type type, bool own, int shot)
+{
+  for(int i = 0; i < numOfEvents; ++i)
+  {
+    const PenaltyShootout::Event& event = shootout.getEvent(i);
+    if(event.type == type && (type == PenaltyShootout::Event::started || type == PenaltyShootout::Event::finished ||
+                              (event.own == own && event.shot == shot)))
+      return true;
+  }
+  return false;
+}
+
+int main()
+{
+  typedef PenaltyShootout::Event Event;
+  PenaltyShootout shootout;
+
+  // Nothing happens outside of a shootout.
+  RoboCupGameControlData data = packet(OWN, 0, 0, 0, 0);
+  data.secondaryState = STATE2_NORMAL;
+  CHECK(!shootout.update(data, OWN));
+  CHECK(!shootout.isActive());
+
+  // We shoot first.
+  int n = shootout.update(packet(OWN, 0, 0, 0, 0), OWN);
+  CHECK(shootout.isActive());
+  CHECK(hasEvent(shootout, n, Event::started, false, 0));
+  CHECK(shootout.isShooting());
+  CHECK(shootout.isShootingNext());
+
+  // Our first shot starts and scores.
+  n = shootout.update(packet(OWN, 1, 0, 0, 0), OWN);
+  CHECK(hasEvent(shootout, n, Event::attempt, true, 0));
+  CHECK(shootout.isPending(true));
+  n = shootout.update(packet(OWN, 1, 1, 0, 0), OWN);
+  CHECK(hasEvent(shootout, n, Event::goal, true, 0));
+  CHECK(!shootout.isPending(true));
+  CHECK(shootout.getScore(true) == 1);
+  CHECK(!shootout.isShootingNext());
+
+  // The opponent's first shot starts and is decided as missed when our second one starts.
+  n = shootout.update(packet(OPPONENT, 1, 1, 1, 0), OWN);
+  CHECK(hasEvent(shootout, n, Event::attempt, false, 0));
+  CHECK(!shootout.isShooting());
+  n = shootout.update(packet(OWN, 2, 1, 1, 0), OWN);
+  CHECK(hasEvent(shootout, n, Event::missed, false, 0));
+  CHECK(hasEvent(shootout, n, Event::attempt, true, 1));
+  CHECK(shootout.getScore(false) == 0);
+
+  // The opponent's second shot scores in the same packet it starts in.
+  n = shootout.update(packet(OPPONENT, 2, 1, 2, 2), OWN);
+  CHECK(hasEvent(shootout, n, Event::missed, true, 1));
+  CHECK(hasEvent(shootout, n, Event::attempt, false, 1));
+  CHECK(hasEvent(shootout, n, Event::goal, false, 1));
+  CHECK(shootout.getScore(true) == 1);
+  CHECK(shootout.getScore(false) == 1);
+  CHECK(shootout.getShots(true) == 2);
+  CHECK(shootout.getShots(false) == 2);
+
+  // The shootout ends.
+  data = packet(OWN, 2, 1, 2, 2);
+  data.state = STATE_FINISHED;
+  data.secondaryState = STATE2_NORMAL;
+  n = shootout.update(data, OWN);
+  CHECK(hasEvent(shootout, n, Event::finished, false, 0));
+  CHECK(!shootout.isActive());
+
+  // Lost packets: shots in between count as missed unless their bits are set.
+  PenaltyShootout lossy;
+  lossy.update(packet(OWN, 0, 0, 0, 0), OWN);
+  n = lossy.update(packet(OWN, 3, 0x5, 0, 0), OWN);
+  CHECK(hasEvent(lossy, n, Event::goal, true, 0));
+  CHECK(hasEvent(lossy, n, Event::missed, true, 1));
+  CHECK(hasEvent(lossy, n, Event::goal, true, 2));
+  CHECK(lossy.getScore(true) == 2);
+
+  return reportTest("PenaltyShootout");
+}
@@ -0,0 +1,46 @@
+/**
+ * @file TestRateLimiter.cpp
+ * Checks that the rate limiter lets bursts through, drops floods and keeps
+ * senders apart.
+ */
+
+#include "RateLimiter.h"
+#include "Test.h"
+
+int main()
+{
+  static const uint32_t FLOODER = 0x0a000001;
+  static const uint32_t OTHER = 0x0a000002;
+
+  // A flood is cut off after the burst, while another sender is not affected.
+  RateLimiter limiter(10.f, 20.f);
+  const long long start = 1000000;
+  int accepted = 0;
+  for(int i = 0; i < 1000; ++i)
+    accepted += limiter.admit(FLOODER, start) == RateLimiter::accepted;
+  CHECK(accepted == 20);
+  CHECK(limiter.admit(FLOODER, start) == RateLimiter::rateLimited);
+  CHECK(limiter.admit(OTHER, start) == RateLimiter::accepted);
+
+  // Tokens come back at the rate: 10 per second.
+  accepted = 0;
+  for(int i = 0; i < 1000; ++i)
+    accepted += limiter.admit(FLOODER, start + 1000000) == RateLimiter::accepted;
+  CHECK(accepted == 10);
+
+  // A sender within its rate is never dropped.
+  RateLimiter steady(10.f, 20.f);
+  bool allAccepted = true;
+  for(int i = 0; i < 100; ++i)
+    allAccepted &= steady.admit(FLOODER, start + i * 100000LL) == RateLimiter::accepted;
+  CHECK(allAccepted);
+
+  // Senders that are all still limited fill the table, so a new one is rejected.
+  RateLimiter full(10.f, 20.f);
+  bool tableFull = false;
+  for(uint32_t source = 1; source <= 1000 && !tableFull; ++source)
+    tableFull = full.admit(source, start) == RateLimiter::tableFull;
+  CHECK(tableFull);
+
+  return reportTest("RateLimiter");
+}
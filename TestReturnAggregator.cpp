@@ -0,0 +1,129 @@
+/**
+ * @file TestReturnAggregator.cpp
+ * Checks that ReturnAggregator rejects invalid return packets, tracks the
+ * robots alive and collects the manual requests per receive(), and that its
+ * socket filter drops packets with the wrong size or header in the kernel,
+ * so receive() never reads them. The packets are sent through the loopback
+ * interface to a port that a.out does not use.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "ReturnAggregator.h"
+#include "UdpComm.h"
+#include "Test.h"
+
+static const int PORT = 38381; /**< The port the aggregator listens on. */
+static const long long SECOND = 1000000; /**< One second in µs. */
+
+/** Returns a return packet. */
+static RoboCupGameControlReturnData packet(int team, int player, int message)
+{
+  RoboCupGameControlReturnData data;
+  data.team = (uint8_t) team;
+  data.player = (uint8_t) player;
+  data.message = (uint8_t) message;
+  return data;
+}
+
+/** Adds a packet directly. */
+static bool add(ReturnAggregator& aggregator, const RoboCupGameControlReturnData& data, long long now,
+                int size = (int) sizeof(RoboCupGameControlReturnData))
+{
+  return aggregator.add((const char*) &data, size, htonl(INADDR_LOOPBACK), now);
+}
+
+/** Sends a packet to the aggregator. */
+static void send(UdpComm& sender, const RoboCupGameControlReturnData& data,
+                 int size = (int) sizeof(RoboCupGameControlReturnData))
+{
+  char buffer[sizeof(RoboCupGameControlReturnData) + 1] = {0};
+  memcpy(buffer, &data, sizeof(data));
+  CHECK(sender.write(buffer, size));
+}
+
+int main()
+{
+  ReturnAggregator aggregator(PORT);
+  CHECK(aggregator.isOpen());
+  if(!aggregator.isOpen())
+    return reportTest("ReturnAggregator");
+
+  // Each rejection is counted by its reason.
+  const long long now = 10 * SECOND;
+  RoboCupGameControlReturnData data = packet(3, 2, GAMECONTROLLER_RETURN_MSG_ALIVE);
+  CHECK(!add(aggregator, data, now, (int) sizeof(data) - 1));
+  CHECK(!add(aggregator, data, now, (int) sizeof(data) + 1));
+  data.header[0] = 'X';
+  CHECK(!add(aggregator, data, now));
+  CHECK(aggregator.getDrops().malformed == 3);
+  data = packet(3, 2, GAMECONTROLLER_RETURN_MSG_ALIVE);
+  ++data.version;
+  CHECK(!add(aggregator, data, now));
+  CHECK(aggregator.getDrops().wrongVersion == 1);
+  CHECK(!add(aggregator, packet(3, 0, GAMECONTROLLER_RETURN_MSG_ALIVE), now));
+  CHECK(!add(aggregator, packet(3, MAX_NUM_PLAYERS + 1, GAMECONTROLLER_RETURN_MSG_ALIVE), now));
+  CHECK(aggregator.getDrops().invalidPlayer == 2);
+  CHECK(!add(aggregator, packet(3, 2, GAMECONTROLLER_RETURN_MSG_ALIVE + 1), now));
+  CHECK(aggregator.getDrops().invalidMessage == 1);
+  CHECK(!aggregator.getNumOfPackets() && !aggregator.getLastSeen(3, 2));
+
+  // Every valid message shows that the robot is alive, but only manual ones are requests.
+  CHECK(add(aggregator, packet(3, 2, GAMECONTROLLER_RETURN_MSG_ALIVE), now));
+  CHECK(add(aggregator, packet(200, MAX_NUM_PLAYERS, GAMECONTROLLER_RETURN_MSG_MAN_PENALISE), now + 1));
+  CHECK(aggregator.getNumOfPackets() == 2);
+  CHECK(aggregator.getNumOfRequests() == 1);
+  const ReturnAggregator::Request& request = aggregator.getRequest(0);
+  CHECK(request.team == 200 && request.player == MAX_NUM_PLAYERS &&
+        request.message == GAMECONTROLLER_RETURN_MSG_MAN_PENALISE &&
+        request.address == htonl(INADDR_LOOPBACK) && request.timestamp == now + 1);
+  CHECK(aggregator.getLastSeen(3, 2) == now);
+  CHECK(aggregator.isAlive(3, 2, now + ReturnAggregator::ALIVE_TIMEOUT - 1));
+  CHECK(!aggregator.isAlive(3, 2, now + ReturnAggregator::ALIVE_TIMEOUT));
+  int alive = 0;
+  aggregator.forEachAlive(now + 1, [&](int team, int player, long long)
+  {
+    CHECK((team == 3 && player == 2) || (team == 200 && player == MAX_NUM_PLAYERS));
+    ++alive;
+  });
+  CHECK(alive == 2);
+
+  // The kernel drops packets with the wrong size or header. Packets with a
+  // wrong version or player pass the filter and are rejected by add().
+  UdpComm sender;
+  CHECK(sender.setTarget("127.0.0.1", PORT));
+  data = packet(4, 1, GAMECONTROLLER_RETURN_MSG_ALIVE);
+  send(sender, data, (int) sizeof(data) - 1);
+  send(sender, data, (int) sizeof(data) + 1);
+  data.header[3] = 'X';
+  send(sender, data);
+  data = packet(4, 1, GAMECONTROLLER_RETURN_MSG_ALIVE);
+  ++data.version;
+  send(sender, data);
+  send(sender, packet(4, 0, GAMECONTROLLER_RETURN_MSG_ALIVE));
+  send(sender, packet(4, 1, GAMECONTROLLER_RETURN_MSG_MAN_UNPENALISE));
+  send(sender, packet(4, 2, GAMECONTROLLER_RETURN_MSG_ALIVE));
+  send(sender, packet(4, 3, GAMECONTROLLER_RETURN_MSG_MAN_PENALISE));
+  usleep(100000);
+
+  // The requests of the previous calls are forgotten.
+  CHECK(aggregator.receive(now + SECOND) == 5);
+  CHECK(aggregator.getDrops().malformed == 3);
+  CHECK(aggregator.getDrops().wrongVersion == 2);
+  CHECK(aggregator.getDrops().invalidPlayer == 3);
+  CHECK(aggregator.getNumOfPackets() == 5);
+  CHECK(aggregator.getNumOfRequests() == 2);
+  CHECK(aggregator.getRequest(0).team == 4 && aggregator.getRequest(0).player == 1 &&
+        aggregator.getRequest(0).message == GAMECONTROLLER_RETURN_MSG_MAN_UNPENALISE &&
+        aggregator.getRequest(0).address == htonl(INADDR_LOOPBACK));
+  CHECK(aggregator.getRequest(1).player == 3 &&
+        aggregator.getRequest(1).message == GAMECONTROLLER_RETURN_MSG_MAN_PENALISE);
+  CHECK(aggregator.isAlive(4, 2, now + SECOND));
+
+  // Nothing is left, and no requests are reported twice.
+  CHECK(!aggregator.receive(now + 2 * SECOND));
+  CHECK(!aggregator.getNumOfRequests());
+
+  return reportTest("ReturnAggregator");
+}
@@ -0,0 +1,101 @@
+/**
+ * @file TestSocketFilter.cpp
+ * Checks that the socket filter of GameCtrl rejects packets with the wrong
+ * size, header, version or team in the kernel, so receive() never sees them.
+ * The packets are sent to GAMECONTROLLER_PORT through the loopback interface.
+ * Also checks that receive() only reports an exhausted budget if packets
+ * are left in the queue.
+ */
+
+#include <unistd.h>
+#include "GameCtrl.h"
+#include "Test.h"
+
+static const int OWN = 2; /**< The number of our team. */
+
+/** Sends a packet to the GameCtrl. */
+static void send(UdpComm& sender, const RoboCupGameControlData& data, int size = (int) sizeof(RoboCupGameControlData))
+{
+  CHECK(sender.write((const char*) &data, size));
+}
+
+/** Sends a correct packet and a copy of it with a defect for each check of the filter. */
+static void sendAll(UdpComm& sender, uint8_t packetNumber)
+{
+  RoboCupGameControlData data;
+  memset(&data, 0, sizeof(data));
+  memcpy(data.header, GAMECONTROLLER_STRUCT_HEADER, sizeof(data.header));
+  data.version = GAMECONTROLLER_STRUCT_VERSION;
+  data.teams[0].teamNumber = 5;
+  data.teams[1].teamNumber = OWN;
+
+  RoboCupGameControlData defect = data;
+  defect.packetNumber = (uint8_t) (packetNumber + 1);
+  send(sender, defect, (int) sizeof(defect) - 1);
+  defect.packetNumber = (uint8_t) (packetNumber + 2);
+  defect.header[0] = 'X';
+  send(sender, defect);
+  defect = data;
+  defect.packetNumber = (uint8_t) (packetNumber + 3);
+  ++defect.version;
+  send(sender, defect);
+  defect = data;
+  defect.packetNumber = (uint8_t) (packetNumber + 4);
+  defect.teams[1].teamNumber = 6;
+  send(sender, defect);
+
+  data.packetNumber = packetNumber;
+  send(sender, data);
+}
+
+/** Were any packets dropped by receive()? */
+static bool hasDrops(const GameCtrl<DefaultLeague>& gameCtrl)
+{
+  const GameCtrl<DefaultLeague>::Drops& drops = gameCtrl.drops;
+  return drops.otherInterface || drops.rateLimited || drops.tooManySenders || drops.malformed ||
+         drops.wrongVersion || drops.otherTeam || drops.duplicates;
+}
+
+int main()
+{
+  GameCtrl<DefaultLeague> gameCtrl;
+  CHECK(gameCtrl.udp);
+  if(!gameCtrl.udp)
+    return reportTest("SocketFilter");
+
+  UdpComm sender;
+  CHECK(sender.setTarget("127.0.0.1", GAMECONTROLLER_PORT));
+
+  // Without a team number, nothing is accepted.
+  sendAll(sender, 10);
+  usleep(100000);
+  CHECK(!gameCtrl.receive());
+  CHECK(!hasDrops(gameCtrl));
+
+  // With a team number, only the correct packet passes.
+  gameCtrl.setTeamNumber(OWN);
+  sendAll(sender, 20);
+  usleep(100000);
+  CHECK(gameCtrl.receive());
+  CHECK(gameCtrl.gameCtrlData.packetNumber == 20);
+  CHECK(!hasDrops(gameCtrl));
+  CHECK(!gameCtrl.receive());
+
+  // Reading exactly as many packets as the budget allows empties the queue.
+  for(int i = 0; i < MAX_PACKETS_PER_RECEIVE; ++i)
+    sendAll(sender, (uint8_t) (40 + i));
+  usleep(100000);
+  gameCtrl.receive();
+  CHECK(!gameCtrl.drops.budgetExhausted);
+
+  // One more packet is left for the next call.
+  for(int i = 0; i <= MAX_PACKETS_PER_RECEIVE; ++i)
+    sendAll(sender, (uint8_t) (80 + i));
+  usleep(100000);
+  gameCtrl.receive();
+  CHECK(gameCtrl.drops.budgetExhausted == 1);
+  gameCtrl.receive();
+  CHECK(gameCtrl.drops.budgetExhausted == 1);
+
+  return reportTest("SocketFilter");
+}
@@ -0,0 +1,161 @@
+/**
+ * @file TestTeamComm.cpp
+ * Checks that TeamComm accepts the messages of its team, switches to
+ * drop-in mode with the game type, and that its table of robots ages,
+ * reuses and evicts slots. The messages are sent to the team port through
+ * the loopback interface from several addresses, so the rate limit per
+ * sender is not reached.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "TeamComm.h"
+#include "UdpComm.h"
+#include "Test.h"
+
+static const int OWN = 5; /**< The number of our team. */
+static const int NUM_OF_SENDERS = 8; /**< The senders use the addresses 127.0.0.2 and following. */
+static const int TABLE_SIZE = 64; /**< The number of robots TeamComm keeps. */
+static const long long STEP = 100000; /**< The time between the batches of messages in µs. */
+
+/** Sends a message of a robot. */
+static void send(UdpComm& sender, int teamNum, int playerNum)
+{
+  SPLStandardMessage message;
+  message.teamNum = (int8_t) teamNum;
+  message.playerNum = (int8_t) playerNum;
+  message.numOfDataBytes = 1;
+  message.data[0] = (uint8_t) (teamNum + playerNum);
+  CHECK(sender.write((const char*) &message, (int) offsetof(SPLStandardMessage, data) + 1));
+}
+
+/** Reads all messages queued and returns the number accepted. */
+static int receive(TeamComm& teamComm, long long now)
+{
+  int accepted = 0;
+  for(int count; (count = teamComm.receive(now)) > 0;)
+    accepted += count;
+  return accepted;
+}
+
+/** Returns the number of robots alive. */
+static int countPlayers(const TeamComm& teamComm, long long now)
+{
+  int count = 0;
+  teamComm.forEachPlayer(now, [&](const TeamComm::Player&) {++count;});
+  return count;
+}
+
+/**
+ * Sends a batch of messages of robots of other teams, spread over the senders.
+ * @param first The index of the first robot. Robot i is player i % 8 + 1 of team 10 + i / 8.
+ * @param count The number of robots.
+ */
+static void sendRobots(UdpComm* senders, int first, int count)
+{
+  for(int i = first; i < first + count; ++i)
+    send(senders[i % NUM_OF_SENDERS], 10 + i / 8, i % 8 + 1);
+}
+
+int main()
+{
+  TeamComm teamComm(OWN);
+  CHECK(teamComm.udp);
+  if(!teamComm.udp)
+    return reportTest("TeamComm");
+
+  UdpComm senders[NUM_OF_SENDERS];
+  for(int i = 0; i < NUM_OF_SENDERS; ++i)
+  {
+    char address[INET_ADDRSTRLEN];
+    snprintf(address, sizeof(address), "127.0.0.%d", i + 2);
+    CHECK(senders[i].bind(address, 0) && senders[i].setTarget("127.0.0.1", TeamComm::BASE_PORT + OWN));
+  }
+
+  // Only messages of the own team are accepted.
+  long long now = 1000000;
+  send(senders[0], OWN, 1);
+  send(senders[0], 9, 1);
+  CHECK(receive(teamComm, now) == 1);
+  CHECK(teamComm.getDrops().otherTeam == 1);
+  const TeamComm::Player* player = teamComm.getPlayer(OWN, 1, now);
+  CHECK(player && player->numOfMessages == 1 && player->message.data[0] == OWN + 1);
+  CHECK(!teamComm.getPlayer(9, 1, now));
+
+  // A robot not heard from for PLAYER_TIMEOUT is gone. When it reappears, it is counted anew.
+  CHECK(!teamComm.getPlayer(OWN, 1, now + TeamComm::PLAYER_TIMEOUT));
+  now += STEP;
+  send(senders[0], OWN, 1);
+  CHECK(receive(teamComm, now) == 1);
+  player = teamComm.getPlayer(OWN, 1, now);
+  CHECK(player && player->numOfMessages == 2);
+  now += TeamComm::PLAYER_TIMEOUT;
+  send(senders[0], OWN, 1);
+  CHECK(receive(teamComm, now) == 1);
+  player = teamComm.getPlayer(OWN, 1, now);
+  CHECK(player && player->numOfMessages == 1);
+
+  // A drop-in game accepts messages of all teams and reports the last drop-in.
+  RoboCupGameControlData data;
+  memset(&data, 0, sizeof(data));
+  data.gameType = GAME_DROPIN;
+  data.dropInTeam = 9;
+  data.dropInTime = 3;
+  teamComm.update(data, now);
+  CHECK(teamComm.getDropInTeam() == 9 && teamComm.getDropInTime() == now - 3000000);
+  send(senders[0], 9, 1);
+  CHECK(receive(teamComm, now) == 1);
+  CHECK(teamComm.getPlayer(9, 1, now));
+  CHECK(teamComm.getDrops().otherTeam == 1);
+
+  // Fill the table with robots of other teams in batches, so the first batch is the oldest.
+  now += TeamComm::PLAYER_TIMEOUT;
+  CHECK(!countPlayers(teamComm, now));
+  for(int batch = 0; batch < TABLE_SIZE / 16; ++batch, now += STEP)
+  {
+    sendRobots(senders, batch * 16, 16);
+    CHECK(receive(teamComm, now) == 16);
+  }
+  CHECK(countPlayers(teamComm, now) == TABLE_SIZE);
+  CHECK(!teamComm.getDrops().evicted);
+
+  // Another robot evicts one of the oldest batch.
+  sendRobots(senders, TABLE_SIZE, 1);
+  CHECK(receive(teamComm, now) == 1);
+  CHECK(teamComm.getDrops().evicted == 1);
+  CHECK(teamComm.getPlayer(10 + TABLE_SIZE / 8, 1, now));
+  int oldest = 0;
+  for(int i = 0; i < 16; ++i)
+    oldest += teamComm.getPlayer(10 + i / 8, i % 8 + 1, now) != 0;
+  CHECK(oldest == 15);
+  CHECK(countPlayers(teamComm, now) == TABLE_SIZE);
+
+  // When the older batches expired, new robots reuse their slots without
+  // eviction, and robots still alive are found behind expired slots in
+  // their probe chains instead of being added twice.
+  now += TeamComm::PLAYER_TIMEOUT - 5 * STEP / 2;
+  CHECK(countPlayers(teamComm, now) == 32 + 1);
+  sendRobots(senders, 100, 16);
+  CHECK(receive(teamComm, now) == 16);
+  CHECK(teamComm.getDrops().evicted == 1);
+  CHECK(countPlayers(teamComm, now) == 32 + 1 + 16);
+  sendRobots(senders, 48, 16);
+  CHECK(receive(teamComm, now) == 16);
+  CHECK(countPlayers(teamComm, now) == 32 + 1 + 16);
+  for(int i = 48; i < 64; ++i)
+  {
+    player = teamComm.getPlayer(10 + i / 8, i % 8 + 1, now);
+    CHECK(player && player->numOfMessages == 2);
+  }
+  CHECK(teamComm.getDrops().evicted == 1);
+
+  // Outside of drop-in games, other teams are rejected again.
+  data.gameType = GAME_ROUNDROBIN;
+  teamComm.update(data, now);
+  send(senders[0], 9, 1);
+  CHECK(!receive(teamComm, now));
+  CHECK(teamComm.getDrops().otherTeam == 2);
+
+  return reportTest("TeamComm");
+}
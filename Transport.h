@@ -0,0 +1,64 @@
+/**
+ * @file Transport.h
+ * Declares the interface of datagram transports.
+ */
+
+#pragma once
+
+#include <string.h>
+#include <netinet/in.h>
+
+/**
+ * @class Transport
+ * A transport that sends and receives datagrams. Implemented by UdpComm and
+ * LocalTransport. Decorators such as ImpairedTransport wrap another transport.
+ */
+class Transport
+{
+public:
+  virtual ~Transport() {}
+
+  /**
+   * Waits until a packet can be read.
+   * @param timeout The maximum time to wait in ms. -1 waits forever.
+   * @return Can a packet be read?
+   */
+  virtual bool wait(int timeout) = 0;
+
+  /**
+   * The function tries to read a package without blocking.
+   * @return Number of bytes received or -1 if there was none.
+   */
+  virtual int read(char* data, int len) = 0;
+
+  /**
+   * The function tries to read a package and reports where it came from.
+   * Transports that do not know this report an unknown sender (all bytes 0)
+   * and interface 0.
+   * @param from The address of the sender is stored here. May be 0.
+   * @param interfaceIndex The index of the interface the packet arrived on
+   *                       is stored here. May be 0.
+   * @return Number of bytes received or -1 if there was none.
+   */
+  virtual int read(char* data, int len, struct sockaddr_in* from, int* interfaceIndex)
+  {
+    if(from)
+      memset(from, 0, sizeof(*from));
+    if(interfaceIndex)
+      *interfaceIndex = 0;
+    return read(data, len);
+  }
+
+  /**
+  * The function writes a package.
+  * @return True if the package was written.
+  */
+  virtual bool write(const char* data, const int len) = 0;
+
+  /**
+   * Returns why the last write() failed.
+   * @return The errno value of the failure or 0 if the last write()
+   *         succeeded or the transport cannot tell.
+   */
+  virtual int getWriteError() const {return 0;}
+};
@@ -5,8 +5,9 @@
  */
 
 #include "UdpComm.h"
+#include "Log.h"
+#include "SystemTime.h"
 
-#include <iostream>
 #include <cassert>
 #include <cerrno>
 #include <unistd.h>
@@ -14,27 +15,70 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <cstring>
 #include <net/if.h>
-#include <ifaddrs.h>
-#include <string>
+#include <stdlib.h>
+#include <linux/filter.h>
+
+static const int MAX_CONSECUTIVE_FAILURES = 3; /**< A path is suspended after this many failures in a row. */
+static const int MIN_BACKOFF = 1000; /**< The first suspension of a path in ms. */
+static const int MAX_BACKOFF = 30000; /**< The longest suspension of a path in ms. */
+static const int MAX_BATCH = 64; /**< writeTo(), readBatch() and writeSegmented() handle at most this many packets per system call. */
+static const int MAX_UDP_PAYLOAD = 65507; /**< The maximum size of a buffer passed to UDP_SEGMENT. */
+static const int MAX_INTERFACES = 64; /**< getBroadcastAddress() looks at most at this many addresses. */
 
 UdpComm::UdpComm()
+: numOfPaths(1),
+  peer(-1),
+  epoll(-1),
+  busyPollTime(0),
+  pollTime(0),
+  segmentation(true)
 {
   sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
   target = (struct sockaddr*) (new struct sockaddr_in);
+  mirrors = new struct sockaddr_in[maxNumOfPaths - 1];
+  memset(&stats, 0, sizeof(stats));
+  writeError = 0;
+  memset(paths, 0, sizeof(paths));
+  paths[0].backoff = MIN_BACKOFF;
 
   assert(sock != -1);
 }
 
+UdpComm::UdpComm(int socket)
+: numOfPaths(1),
+  sock(socket),
+  peer(-1),
+  epoll(-1),
+  busyPollTime(0),
+  pollTime(0),
+  segmentation(true)
+{
+  target = (struct sockaddr*) (new struct sockaddr_in);
+  memset(target, 0, sizeof(struct sockaddr_in));
+  mirrors = new struct sockaddr_in[maxNumOfPaths - 1];
+  memset(&stats, 0, sizeof(stats));
+  writeError = 0;
+  memset(paths, 0, sizeof(paths));
+  paths[0].backoff = MIN_BACKOFF;
+}
+
 UdpComm::~UdpComm()
 {
+  if(epoll != -1)
+    close(epoll);
+  if(peer != -1)
+    close(peer);
   close(sock);
   delete (struct sockaddr_in*) target;
+  delete [] mirrors;
 }
 
 bool UdpComm::resolve(const char* addrStr, int port, struct sockaddr_in* addr)
@@ -51,25 +95,64 @@ bool UdpComm::resolve(const char* addrStr, int port, struct sockaddr_in* addr)
 #endif
   if(inet_pton(AF_INET, addrStr, &(addr->sin_addr.s_addr)) != 1)
   {
-    std::cerr << addrStr << " is not a valid dotted ipv4 address" << std::endl;
+    LOG("%s is not a valid dotted ipv4 address", addrStr);
     return false;
   }
 
   return true;
 }
 
-bool UdpComm::setTarget(const char* addrStr, int port)
+bool UdpComm::setTarget(const char* addrStr, int port, bool connected)
 {
   struct sockaddr_in* addr = (struct sockaddr_in*) target;
-  return resolve(addrStr, port, addr);
+  if(peer != -1)
+  {
+    close(peer);
+    peer = -1;
+  }
+  if(!resolve(addrStr, port, addr))
+    return false;
+  if(connected)
+  {
+    // The peer inherits the blocking mode and the device binding of the socket.
+    char device[IFNAMSIZ];
+    socklen_t deviceLength = sizeof(device);
+    if(getsockopt(sock, SOL_SOCKET, SO_BINDTODEVICE, device, &deviceLength) == -1)
+      deviceLength = 0;
+    const int flags = fcntl(sock, F_GETFL);
+    peer = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(peer == -1 || flags == -1 || fcntl(peer, F_SETFL, flags) == -1 ||
+       (deviceLength > 1 && setsockopt(peer, SOL_SOCKET, SO_BINDTODEVICE, device, deviceLength) == -1) ||
+       connect(peer, target, sizeof(struct sockaddr_in)) == -1)
+    {
+      LOG("UdpComm::setTarget() failed: %s", strerror(errno));
+      if(peer != -1)
+        close(peer);
+      peer = -1;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool UdpComm::addTarget(const char* addrStr, int port)
+{
+  if(numOfPaths == maxNumOfPaths)
+  {
+    LOG("UdpComm::addTarget() failed: too many targets");
+    return false;
+  }
+  if(!resolve(addrStr, port, &mirrors[numOfPaths - 1]))
+    return false;
+  memset(&paths[numOfPaths], 0, sizeof(Path));
+  paths[numOfPaths++].backoff = MIN_BACKOFF;
+  return true;
 }
 
 bool UdpComm::setBlocking(bool block)
 {
-  if(block)
-    return fcntl(sock, F_SETFL, 0) != -1;
-  else
-    return fcntl(sock, F_SETFL, O_NONBLOCK) != -1;
+  const int flags = block ? 0 : O_NONBLOCK;
+  return fcntl(sock, F_SETFL, flags) != -1 && (peer == -1 || fcntl(peer, F_SETFL, flags) != -1);
 }
 
 bool UdpComm::setLoopback(bool yesno)
@@ -77,7 +160,7 @@ bool UdpComm::setLoopback(bool yesno)
   char val = yesno ? 1 : 0;
   if(setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &val, sizeof(char)) < 0)
   {
-    std::cerr << "could not set ip_multicast_loop to " << val << std::endl;
+    LOG("could not set ip_multicast_loop to %d", val);
     return false;
   }
   return true;
@@ -91,7 +174,7 @@ bool UdpComm::setBroadcast(bool enable)
     return true;
   else
   {
-    std::cerr << "UdpComm::setBroadcast() failed: " << strerror(errno) << std::endl;
+    LOG("UdpComm::setBroadcast() failed: %s", strerror(errno));
     return false;
   }
 }
@@ -113,67 +196,587 @@ bool UdpComm::bind(const char* addr_str, int port)
 
   if(inet_pton(AF_INET, addr_str, &(addr.sin_addr)) <= 0)
   {
-    std::cerr << "UdpComm::bind() failed: invalid address " << addr_str << std::endl;
+    LOG("UdpComm::bind() failed: invalid address %s", addr_str);
     return false;
   }
 
 #ifdef SO_REUSEADDR
   if(-1 == setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes)))
-    std::cerr << "UdpComm: could not set SO_REUSEADDR" << std::endl;
+    LOG("UdpComm: could not set SO_REUSEADDR");
 #endif
 #ifdef SO_REUSEPORT
   if(-1 == setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char*)&yes, sizeof(yes)))
-    std::cerr << "UdpComm: could not set SO_REUSEPORT" << std::endl;
+    LOG("UdpComm: could not set SO_REUSEPORT");
 #endif
   if(-1 == ::bind(sock, (struct sockaddr*)&addr, sizeof(struct sockaddr_in)))
   {
-    std::cout << "UdpComm::bind() failed: " << strerror(errno) << std::endl;
+    LOG("UdpComm::bind() failed: %s", strerror(errno));
     return false;
   }
 
   return true;
 }
 
+bool UdpComm::setFilter(const struct sock_filter* code, unsigned short len)
+{
+  struct sock_fprog prog;
+  prog.len = len;
+  prog.filter = const_cast<struct sock_filter*>(code);
+  if(setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) == 0)
+    return true;
+  else
+  {
+    LOG("UdpComm::setFilter() failed: %s", strerror(errno));
+    return false;
+  }
+}
+
+bool UdpComm::setFilter(int progFd)
+{
+#ifdef SO_ATTACH_BPF
+  if(setsockopt(sock, SOL_SOCKET, SO_ATTACH_BPF, &progFd, sizeof(progFd)) == 0)
+    return true;
+  LOG("UdpComm::setFilter() failed: %s", strerror(errno));
+#else
+  (void) progFd;
+  LOG("UdpComm::setFilter() failed: eBPF not supported");
+#endif
+  return false;
+}
+
+bool UdpComm::clearFilter()
+{
+  int dummy = 0;
+  return setsockopt(sock, SOL_SOCKET, SO_DETACH_FILTER, &dummy, sizeof(dummy)) == 0;
+}
+
+bool UdpComm::wait(int timeout)
+{
+  struct epoll_event event;
+  if(epoll == -1)
+  {
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    if(epoll == -1 || epoll_ctl(epoll, EPOLL_CTL_ADD, sock, &event) == -1)
+    {
+      LOG("UdpComm::wait() failed: %s", strerror(errno));
+      return false;
+    }
+  }
+
+  if(busyPollTime)
+  {
+    const long long start = getMicroseconds();
+    long long now = start;
+    do
+    {
+      if(epoll_wait(epoll, &event, 1, 0) > 0)
+      {
+        pollTime = pollTime * 2 > busyPollTime ? busyPollTime : pollTime * 2;
+        return true;
+      }
+      now = getMicroseconds();
+    }
+    while(now - start < pollTime && (timeout < 0 || now - start < timeout * 1000LL));
+    pollTime /= 2;
+
+    if(timeout >= 0)
+      timeout -= (int) ((now - start) / 1000);
+    if(timeout < 0)
+      timeout = 0;
+    if(epoll_wait(epoll, &event, 1, timeout) > 0)
+    {
+      if(getMicroseconds() - now < busyPollTime) // polling a little longer would have been enough
+        pollTime = pollTime ? (pollTime * 2 > busyPollTime ? busyPollTime : pollTime * 2) : 1;
+      return true;
+    }
+    return false;
+  }
+  else
+    return epoll_wait(epoll, &event, 1, timeout) > 0;
+}
+
+bool UdpComm::setLowLatency(int busyPollTime, int budget)
+{
+  bool success = true;
+  this->busyPollTime = busyPollTime;
+  pollTime = busyPollTime;
+#ifdef SO_BUSY_POLL
+  if(setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &busyPollTime, sizeof(busyPollTime)) == -1)
+  {
+    LOG("UdpComm: could not set SO_BUSY_POLL: %s", strerror(errno));
+    success = false;
+  }
+#endif
+#ifdef SO_PREFER_BUSY_POLL
+  int prefer = busyPollTime ? 1 : 0;
+  if(setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer)) == -1)
+  {
+    LOG("UdpComm: could not set SO_PREFER_BUSY_POLL: %s", strerror(errno));
+    success = false;
+  }
+#endif
+#ifdef SO_BUSY_POLL_BUDGET
+  if(busyPollTime && setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &budget, sizeof(budget)) == -1)
+  {
+    LOG("UdpComm: could not set SO_BUSY_POLL_BUDGET: %s", strerror(errno));
+    success = false;
+  }
+#else
+  (void) budget;
+#endif
+  return success;
+}
+
+bool UdpComm::setPacketInfo(bool enable)
+{
+  int yes = enable ? 1 : 0;
+  if(setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &yes, sizeof(yes)) == 0)
+    return true;
+  else
+  {
+    LOG("UdpComm::setPacketInfo() failed: %s", strerror(errno));
+    return false;
+  }
+}
+
+bool UdpComm::setGro(bool enable)
+{
+  int yes = enable ? 1 : 0;
+  if(setsockopt(sock, IPPROTO_UDP, UDP_GRO, &yes, sizeof(yes)) == 0)
+    return true;
+  else
+  {
+    LOG("UdpComm::setGro() failed: %s", strerror(errno));
+    return false;
+  }
+}
+
 int UdpComm::read(char* data, int len)
 {
   return ::recv(sock, data, len, 0);
 }
 
+int UdpComm::read(char* data, int len, struct sockaddr_in* from, int* interfaceIndex)
+{
+  struct iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = len;
+  char control[CMSG_SPACE(sizeof(struct in_pktinfo))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = from;
+  msg.msg_namelen = from ? sizeof(struct sockaddr_in) : 0;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  const int size = (int) ::recvmsg(sock, &msg, 0);
+  if(interfaceIndex)
+  {
+    *interfaceIndex = 0;
+    if(size >= 0)
+      for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        if(cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO)
+        {
+          struct in_pktinfo info;
+          memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+          *interfaceIndex = info.ipi_ifindex;
+        }
+  }
+  return size;
+}
+
+int UdpComm::readSegmented(char* data, int len, int* segmentSize)
+{
+  struct iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = len;
+  char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  const int size = (int) ::recvmsg(sock, &msg, 0);
+  *segmentSize = size;
+  if(size > 0)
+    for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+      if(cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+        memcpy(segmentSize, CMSG_DATA(cmsg), sizeof(int));
+  return size;
+}
+
+int UdpComm::split(const char* data, int len, int segmentSize, const char** messages, int* sizes, int maxNumOfMessages)
+{
+  if(segmentSize <= 0)
+    return 0;
+  int numOfMessages = 0;
+  for(int offset = 0; offset < len; offset += segmentSize, ++numOfMessages)
+    if(numOfMessages < maxNumOfMessages)
+    {
+      messages[numOfMessages] = data + offset;
+      sizes[numOfMessages] = len - offset < segmentSize ? len - offset : segmentSize;
+    }
+  return numOfMessages;
+}
+
+int UdpComm::readBatch(char* data, int len, int* sizes, struct sockaddr_in* from, int count)
+{
+  struct iovec iovs[MAX_BATCH];
+  struct mmsghdr messages[MAX_BATCH];
+  if(count > MAX_BATCH)
+    count = MAX_BATCH;
+  for(int i = 0; i < count; ++i)
+  {
+    iovs[i].iov_base = data + i * len;
+    iovs[i].iov_len = len;
+    struct mmsghdr& message = messages[i];
+    memset(&message, 0, sizeof(message));
+    message.msg_hdr.msg_name = from ? &from[i] : 0;
+    message.msg_hdr.msg_namelen = from ? sizeof(struct sockaddr_in) : 0;
+    message.msg_hdr.msg_iov = &iovs[i];
+    message.msg_hdr.msg_iovlen = 1;
+  }
+
+  const int received = recvmmsg(sock, messages, count, 0, 0);
+  for(int i = 0; i < received; ++i)
+    sizes[i] = (int) messages[i].msg_len;
+  return received;
+}
+
 bool UdpComm::write(const char* data, const int len)
 {
-  return ::sendto(sock, data, len, 0,
-                  target, sizeof(struct sockaddr_in)) == len;
+  if(numOfPaths > 1)
+    return writeMirrored(data, len);
+
+  const ssize_t sent = peer != -1 ? ::send(peer, data, len, 0)
+                                  : ::sendto(sock, data, len, 0, target, sizeof(struct sockaddr_in));
+  writeError = sent == len ? 0 : sent == -1 ? errno : EMSGSIZE;
+  if(sent == len)
+  {
+    ++stats.sent;
+    return true;
+  }
+  else if(writeError == ECONNREFUSED)
+    ++stats.unreachable;
+  else
+    ++stats.failed;
+  return false;
+}
+
+bool UdpComm::writeMirrored(const char* data, const int len)
+{
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(data);
+  iov.iov_len = len;
+  struct mmsghdr messages[maxNumOfPaths];
+  int pathIndices[maxNumOfPaths];
+  int numOfMessages = 0;
+
+  // If all paths are suspended, all are tried.
+  long long now = getMicroseconds();
+  for(int pass = 0; pass < 2 && !numOfMessages; ++pass)
+    for(int i = 0; i < numOfPaths; ++i)
+      if(pass || paths[i].suspendedUntil <= now)
+      {
+        struct mmsghdr& message = messages[numOfMessages];
+        memset(&message, 0, sizeof(message));
+        message.msg_hdr.msg_name = i ? (void*) &mirrors[i - 1] : (void*) target;
+        message.msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        message.msg_hdr.msg_iov = &iov;
+        message.msg_hdr.msg_iovlen = 1;
+        pathIndices[numOfMessages++] = i;
+      }
+
+  // sendmmsg() stops at the first failure, so the remaining messages are sent in another call.
+  bool success = false;
+  writeError = 0;
+  for(int first = 0; first < numOfMessages;)
+  {
+    const long long start = now;
+    int sent = sendmmsg(sock, messages + first, numOfMessages - first, 0);
+    now = getMicroseconds();
+    const int latency = sent > 0 ? (int) ((now - start) * 1000 / sent) : 0;
+    for(int i = first; i < first + sent; ++i)
+    {
+      const bool complete = messages[i].msg_len == (unsigned) len;
+      if(complete)
+        ++stats.sent;
+      else
+      {
+        ++stats.failed;
+        writeError = EMSGSIZE;
+      }
+      updatePath(paths[pathIndices[i]], complete, latency, now);
+      success |= complete;
+    }
+    if(sent < 0)
+      sent = 0;
+    if(first + sent < numOfMessages)
+    {
+      writeError = errno;
+      if(errno == ECONNREFUSED)
+        ++stats.unreachable;
+      else
+        ++stats.failed;
+      updatePath(paths[pathIndices[first + sent]], false, 0, now);
+      ++sent;
+    }
+    first += sent;
+  }
+  return success;
+}
+
+bool UdpComm::writeSegmented(const char* data, const int len, int segmentSize)
+{
+  if(segmentSize <= 0 || segmentSize > MAX_UDP_PAYLOAD)
+    return false;
+
+  // The kernel accepts a limited number of segments and bytes per buffer.
+  const int maxChunk = (MAX_UDP_PAYLOAD / segmentSize < MAX_BATCH ? MAX_UDP_PAYLOAD / segmentSize : MAX_BATCH) * segmentSize;
+  bool success = true;
+  for(int offset = 0; offset < len; offset += maxChunk)
+  {
+    const int chunk = len - offset < maxChunk ? len - offset : maxChunk;
+    if(!segmentation || chunk <= segmentSize)
+    {
+      success &= writeSeparately(data + offset, chunk, segmentSize);
+      continue;
+    }
+
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(data + offset);
+    iov.iov_len = chunk;
+    char control[CMSG_SPACE(sizeof(uint16_t))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = peer != -1 ? 0 : target;
+    msg.msg_namelen = peer != -1 ? 0 : sizeof(struct sockaddr_in);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    const uint16_t size = (uint16_t) segmentSize;
+    memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+
+    const int numOfSegments = (chunk + segmentSize - 1) / segmentSize;
+    const ssize_t sent = ::sendmsg(peer != -1 ? peer : sock, &msg, 0);
+    if(sent == chunk)
+      stats.sent += numOfSegments;
+    else if(sent == -1 && (errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP))
+    {
+      // No segmentation offload on this path, e.g. an old kernel or a device without checksum offload.
+      LOG("UdpComm: UDP_SEGMENT not supported: %s", strerror(errno));
+      segmentation = false;
+      success &= writeSeparately(data + offset, chunk, segmentSize);
+    }
+    else
+    {
+      if(sent == -1 && errno == ECONNREFUSED)
+        stats.unreachable += numOfSegments;
+      else
+        stats.failed += numOfSegments;
+      success = false;
+    }
+  }
+  return success;
+}
+
+bool UdpComm::writeSeparately(const char* data, const int len, int segmentSize)
+{
+  struct iovec iovs[MAX_BATCH];
+  struct mmsghdr messages[MAX_BATCH];
+  bool success = true;
+  for(int offset = 0; offset < len;)
+  {
+    int numOfMessages = 0;
+    for(; numOfMessages < MAX_BATCH && offset < len; ++numOfMessages, offset += segmentSize)
+    {
+      iovs[numOfMessages].iov_base = const_cast<char*>(data + offset);
+      iovs[numOfMessages].iov_len = len - offset < segmentSize ? len - offset : segmentSize;
+      struct mmsghdr& message = messages[numOfMessages];
+      memset(&message, 0, sizeof(message));
+      message.msg_hdr.msg_name = peer != -1 ? 0 : target;
+      message.msg_hdr.msg_namelen = peer != -1 ? 0 : sizeof(struct sockaddr_in);
+      message.msg_hdr.msg_iov = &iovs[numOfMessages];
+      message.msg_hdr.msg_iovlen = 1;
+    }
+
+    // sendmmsg() stops at the first failure, so the remaining messages are sent in another call.
+    for(int first = 0; first < numOfMessages;)
+    {
+      int sent = sendmmsg(peer != -1 ? peer : sock, messages + first, numOfMessages - first, 0);
+      if(sent < 0)
+        sent = 0;
+      stats.sent += sent;
+      if(first + sent < numOfMessages)
+      {
+        if(errno == ECONNREFUSED)
+          ++stats.unreachable;
+        else
+          ++stats.failed;
+        success = false;
+        ++sent;
+      }
+      first += sent;
+    }
+  }
+  return success;
 }
 
-const char* UdpComm::getWifiBroadcastAddress()
+int UdpComm::writeTo(const char* data, const int len, const struct sockaddr_in* targets, int numOfTargets)
 {
-  struct ifaddrs* ifAddrStruct = NULL;
-  struct ifaddrs* ifa = NULL;
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(data);
+  iov.iov_len = len;
+  struct mmsghdr messages[MAX_BATCH];
+  int written = 0;
+  for(int batch = 0; batch < numOfTargets; batch += MAX_BATCH)
+  {
+    const int numOfMessages = numOfTargets - batch < MAX_BATCH ? numOfTargets - batch : MAX_BATCH;
+    for(int i = 0; i < numOfMessages; ++i)
+    {
+      struct mmsghdr& message = messages[i];
+      memset(&message, 0, sizeof(message));
+      message.msg_hdr.msg_name = (void*) &targets[batch + i];
+      message.msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+      message.msg_hdr.msg_iov = &iov;
+      message.msg_hdr.msg_iovlen = 1;
+    }
+
+    // sendmmsg() stops at the first failure, so the remaining messages are sent in another call.
+    for(int first = 0; first < numOfMessages;)
+    {
+      int sent = sendmmsg(sock, messages + first, numOfMessages - first, 0);
+      for(int i = first; i < first + sent; ++i)
+        if(messages[i].msg_len == (unsigned) len)
+        {
+          ++stats.sent;
+          ++written;
+        }
+        else
+          ++stats.failed;
+      if(sent < 0)
+        sent = 0;
+      if(first + sent < numOfMessages)
+      {
+        if(errno == ECONNREFUSED)
+          ++stats.unreachable;
+        else
+          ++stats.failed;
+        ++sent;
+      }
+      first += sent;
+    }
+  }
+  return written;
+}
 
-  //determine ip address
-  getifaddrs(&ifAddrStruct);
-  for(ifa = ifAddrStruct; ifa != NULL; ifa = ifa->ifa_next)
+void UdpComm::updatePath(Path& path, bool success, int latency, long long now)
+{
+  if(success)
+  {
+    ++path.sent;
+    path.latency = path.latency ? (path.latency * 7 + latency) / 8 : latency;
+    path.consecutiveFailures = 0;
+    path.backoff = MIN_BACKOFF;
+    path.suspendedUntil = 0;
+  }
+  else
   {
-       // manpage getifaddrs    // check it is IP4
-    if(ifa->ifa_addr != NULL && ifa->ifa_addr->sa_family == AF_INET)
+    ++path.failed;
+    if(++path.consecutiveFailures >= MAX_CONSECUTIVE_FAILURES)
     {
-      std::string interfaceName(ifa->ifa_name);
-      if(interfaceName.find("wlan") != std::string::npos)
+      path.suspendedUntil = now + path.backoff * 1000LL;
+      path.backoff = path.backoff * 2 > MAX_BACKOFF ? MAX_BACKOFF : path.backoff * 2;
+    }
+  }
+}
+
+const char* UdpComm::getBroadcastAddress(const char* interfaceName, bool prefix)
+{
+  // SIOCGIFCONF lists the IPv4 interfaces in a single call, which is much
+  // cheaper than the netlink dumps of getifaddrs().
+  const char* result = 0;
+  const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sock == -1)
+    return 0;
+  struct ifreq requests[MAX_INTERFACES];
+  struct ifconf config;
+  config.ifc_len = sizeof(requests);
+  config.ifc_req = requests;
+  if(ioctl(sock, SIOCGIFCONF, &config) == 0)
+    for(int i = 0; i < config.ifc_len / (int) sizeof(struct ifreq) && !result; ++i)
+      if(requests[i].ifr_addr.sa_family == AF_INET &&
+         !strncmp(requests[i].ifr_name, interfaceName, prefix ? strlen(interfaceName) : sizeof(requests[i].ifr_name)))
       {
-        in_addr_t mask = ((struct sockaddr_in *) ifa->ifa_netmask)->sin_addr.s_addr;
-        in_addr_t addr = ((struct sockaddr_in *) ifa->ifa_addr)->sin_addr.s_addr;
-        in_addr_t bcastAddr = ~mask | addr;
+        const in_addr_t addr = ((struct sockaddr_in*) &requests[i].ifr_addr)->sin_addr.s_addr;
+        if(ioctl(sock, SIOCGIFNETMASK, &requests[i]) == -1)
+          continue;
+        const in_addr_t mask = ((struct sockaddr_in*) &requests[i].ifr_netmask)->sin_addr.s_addr;
 
         struct in_addr bcast_addr;
-        bcast_addr.s_addr = bcastAddr;
+        bcast_addr.s_addr = ~mask | addr;
         static char buffer[INET_ADDRSTRLEN];
         inet_ntop(AF_INET,
                   &bcast_addr,
                   buffer,
                   INET_ADDRSTRLEN);
-        return buffer;
+        result = buffer;
       }
+  close(sock);
+  return result;
+}
+
+const char* UdpComm::getWifiBroadcastAddress(bool refresh)
+{
+  // Enumerating the interfaces is the most expensive part of opening a
+  // socket, so an address found is kept. Without wifi, it is looked up again.
+  static char address[INET_ADDRSTRLEN] = "";
+  if(refresh || !*address)
+  {
+    const char* found = getBroadcastAddress("wlan", true);
+    if(!found)
+    {
+      *address = 0;
+      return "255.255.255.255";
+    }
+    strcpy(address, found);
+  }
+  return address;
+}
+
+int UdpComm::getActivatedSocket(int port)
+{
+  const char* pid = getenv("LISTEN_PID");
+  const char* fds = getenv("LISTEN_FDS");
+  if(!pid || !fds || atoi(pid) != (int) getpid())
+    return -1;
+
+  static const int firstFd = 3; // SD_LISTEN_FDS_START
+  for(int fd = firstFd; fd < firstFd + atoi(fds); ++fd)
+  {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int type;
+    socklen_t typeLength = sizeof(type);
+    if(getsockname(fd, (struct sockaddr*) &address, &length) == 0 && address.sin_family == AF_INET &&
+       ntohs(address.sin_port) == port &&
+       getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &typeLength) == 0 && type == SOCK_DGRAM)
+    {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      return fd;
     }
   }
-  return "255.255.255.255";
+  return -1;
 }
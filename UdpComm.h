@@ -6,20 +6,56 @@
 
 #pragma once
 
+#include "Transport.h"
+
 struct sockaddr;
-struct sockaddr_in;
+struct sock_filter;
 
 /**
 * @class UdpComm
 */
-class UdpComm
+class UdpComm : public Transport
 {
 public:
+  /**
+   * Counters of the packets sent.
+   */
+  struct Stats
+  {
+    unsigned sent; /**< Packets written completely. */
+    unsigned failed; /**< Packets that could not be written for other reasons. */
+    unsigned unreachable; /**< Packets refused, because the peer reported its port as unreachable (connected target only). */
+  };
+
+  /**
+   * The scoreboard of a path packets are sent over. Path 0 is the default
+   * target, the others were added with addTarget(). Scoreboards are only kept
+   * while packets are mirrored, i.e. after addTarget() was called.
+   */
+  struct Path
+  {
+    unsigned sent; /**< Packets sent over this path. */
+    unsigned failed; /**< Packets that could not be sent over this path. */
+    unsigned consecutiveFailures; /**< Failures since the last packet sent over this path. */
+    int latency; /**< Smoothed duration of the send calls that carried packets over this path in ns. */
+    int backoff; /**< How long this path is suspended after the next failure in ms. */
+    long long suspendedUntil; /**< Until when this path is not used in µs of the monotonic clock. 0 if active. */
+  };
+
+  enum {maxNumOfPaths = 8}; /**< The maximum number of paths including the default target. */
+
   /**
   * Constructor.
   */
   UdpComm();
 
+  /**
+   * Constructor that adopts a socket that is already open, e.g. one handed
+   * over by another process. Options set on it and its binding are kept.
+   * @param socket The UDP socket. It is closed by the destructor.
+   */
+  explicit UdpComm(int socket);
+
   /**
   * Destructor.
   */
@@ -29,9 +65,31 @@ public:
   * Set default target address.
   * @param ip The ip address of the host system.
   * @param port The port used for the connection.
+  * @param connected Send through a separate socket that is connected to the
+  *                  target. This saves the route lookup per packet and reports
+  *                  ICMP port unreachable errors in the stats. Only use it for
+  *                  fixed unicast peers. Reception is not affected. The
+  *                  separate socket has the blocking mode and the device
+  *                  binding (SO_BINDTODEVICE) of the socket.
   * \return Does a connection exist?
   */
-  bool setTarget(const char* ip, int port);
+  bool setTarget(const char* ip, int port, bool connected = false);
+
+  /**
+   * Adds a target packets are mirrored to. Afterwards, write() sends each
+   * packet to the default target and all targets added in a single system
+   * call. Targets that fail repeatedly are suspended for a growing time and
+   * tried again afterwards. This does not work with a connected target.
+   * @param ip The ip address of the target.
+   * @param port The port of the target.
+   * @return Was the target added?
+   */
+  bool addTarget(const char* ip, int port);
+
+  /**
+   * Removes all targets added with addTarget().
+   */
+  void clearTargets() {numOfPaths = 1;}
 
   /**
    * Set broadcast mode.
@@ -39,7 +97,8 @@ public:
   bool setBroadcast(bool enable);
 
   /**
-   * Sets blocking mode.
+   * Sets blocking mode. It also applies to the socket connected to the
+   * target (see setTarget()).
    */
   bool setBlocking(bool block);
 
@@ -53,26 +112,231 @@ public:
   */
   bool bind(const char* addr, int port);
 
+  /**
+   * Attaches a classic BPF program that the kernel runs on every datagram
+   * before it is queued. Datagrams rejected by the program never reach read().
+   * The program sees the UDP header (8 bytes) followed by the payload.
+   * @param code The instructions of the program.
+   * @param len The number of instructions.
+   * @return Was the filter attached?
+   */
+  bool setFilter(const struct sock_filter* code, unsigned short len);
+
+  /**
+   * Attaches an eBPF socket filter program that was already loaded.
+   * @param progFd The file descriptor returned by bpf(BPF_PROG_LOAD).
+   * @return Was the filter attached?
+   */
+  bool setFilter(int progFd);
+
+  /**
+   * Removes a filter attached with setFilter().
+   */
+  bool clearFilter();
+
+  /**
+   * Waits until a packet can be read.
+   * In low-latency mode, the socket is polled without sleeping first.
+   * @param timeout The maximum time to wait in ms. -1 waits forever.
+   * @return Can a packet be read?
+   */
+  bool wait(int timeout) override;
+
+  /**
+   * Switches the low-latency mode on or off. In this mode, the kernel
+   * busy-polls the device queue when the socket is read or waited on, and
+   * wait() polls the socket for up to busyPollTime before it falls back to
+   * sleeping. The polling time adapts: it shrinks while polling finds nothing
+   * and grows again when packets arrive shortly after falling asleep.
+   * Without CAP_NET_ADMIN, the kernel may refuse values above its defaults.
+   * @param busyPollTime The maximum polling time in µs. 0 switches the mode off.
+   * @param budget The maximum number of packets the kernel handles per busy poll.
+   * @return Could all socket options be set?
+   */
+  bool setLowLatency(int busyPollTime, int budget = 8);
+
+  /**
+   * Sets whether read() reports the interface a packet arrived on.
+   */
+  bool setPacketInfo(bool enable);
+
   /**
   * The function tries to read a package from a socket.
   * @return Number of bytes received or -1 in case of an error.
   */
-  int read(char* data, int len);
+  int read(char* data, int len) override;
+
+  /**
+   * The function tries to read a package from a socket and reports where it came from.
+   * @param from The address of the sender is stored here. May be 0.
+   * @param interfaceIndex The index of the interface the packet arrived on is
+   *                       stored here. It is 0 unless setPacketInfo(true) was
+   *                       called. May be 0.
+   * @return Number of bytes received or -1 in case of an error.
+   */
+  int read(char* data, int len, struct sockaddr_in* from, int* interfaceIndex) override;
+
+  /**
+   * Reads several packets with a single system call.
+   * @param data The packets are stored here, packet i at data + i * len.
+   * @param len The maximum size of each packet.
+   * @param sizes The sizes of the packets are stored here.
+   * @param from The addresses of the senders are stored here. May be 0.
+   * @param count The maximum number of packets to read. At most 64 are read per call.
+   * @return The number of packets read or -1 in case of an error.
+   */
+  int readBatch(char* data, int len, int* sizes, struct sockaddr_in* from, int count);
+
+  /**
+   * Switches the reception of coalesced datagrams on or off (UDP_GRO).
+   * While it is on, the kernel may deliver several datagrams of the same
+   * size from the same sender as a single buffer. Use readSegmented() and
+   * split() to read them, since read() cannot tell them apart.
+   */
+  bool setGro(bool enable);
+
+  /**
+   * Reads a buffer that may contain several datagrams (see setGro()).
+   * @param data The buffer. It should have room for 64 KB.
+   * @param len The size of the buffer.
+   * @param segmentSize The size of the datagrams is stored here. All but
+   *                    the last one have this size. If the buffer is a
+   *                    single datagram, it is the number of bytes received.
+   * @return Number of bytes received or -1 in case of an error.
+   */
+  int readSegmented(char* data, int len, int* segmentSize);
+
+  /**
+   * Splits a buffer read with readSegmented() into its datagrams.
+   * @param data The buffer.
+   * @param len The number of bytes received.
+   * @param segmentSize The size of the datagrams.
+   * @param messages Pointers to the datagrams are stored here.
+   * @param sizes The sizes of the datagrams are stored here.
+   * @param maxNumOfMessages The number of entries of messages and sizes.
+   * @return The number of datagrams. Only the first maxNumOfMessages are stored.
+   */
+  static int split(const char* data, int len, int segmentSize, const char** messages, int* sizes, int maxNumOfMessages);
 
   /**
   * The function writes a package to a socket.
   * @return True if the package was written.
   */
-  bool write(const char* data, const int len);
+  bool write(const char* data, const int len) override;
+
+  /**
+   * Returns why the last write() failed. With mirrors, this is the error of
+   * a path that failed, even if the packet was sent over other paths.
+   * @return The errno value or 0 if the packet was sent over all paths.
+   */
+  int getWriteError() const override {return writeError;}
+
+  /**
+   * Writes many datagrams of the same size to the target. The datagrams are
+   * passed to the kernel as a single buffer that is only split into packets
+   * when they leave the host (UDP_SEGMENT), so the stack is traversed once
+   * per up to 64 datagrams. Where the kernel or the device does not support
+   * this, the datagrams are sent separately with sendmmsg(). The mirrors
+   * are not used.
+   * @param data The datagrams one after another.
+   * @param len The size of all datagrams together.
+   * @param segmentSize The size of each datagram. The last one may be shorter.
+   * @return Were all datagrams written?
+   */
+  bool writeSegmented(const char* data, const int len, int segmentSize);
+
+  /**
+   * Writes the same packet to many addresses, batching the system calls.
+   * The target and the mirrors are not used.
+   * @param data The packet.
+   * @param len Its size.
+   * @param targets The addresses.
+   * @param numOfTargets The number of addresses.
+   * @return The number of addresses the packet was written to completely.
+   */
+  int writeTo(const char* data, const int len, const struct sockaddr_in* targets, int numOfTargets);
+
+  /**
+   * Returns the file descriptor of the socket.
+   */
+  int getSocket() const {return sock;}
+
+  /**
+   * Returns the counters of the packets sent.
+   */
+  const Stats& getStats() const {return stats;}
+
+  /**
+   * Returns the number of paths packets are sent over.
+   * It is 1 unless targets were added with addTarget().
+   */
+  int getNumOfPaths() const {return numOfPaths;}
+
+  /**
+   * Returns the scoreboard of a path.
+   * @param index The index of the path. 0 is the default target.
+   */
+  const Path& getPath(int index) const {return paths[index];}
+
+  /**
+   * Determines the broadcast address of an interface.
+   * @param interfaceName The name of the interface.
+   * @param prefix Is interfaceName only the beginning of the name, e.g.
+   *               "wlan"? Then the first interface matching is used.
+   *               Otherwise, the name must match exactly, so "eth1" does not
+   *               find "eth10".
+   * @return The broadcast address or 0 if there is no such IPv4 interface.
+   *         The buffer is overwritten by the next call.
+   */
+  static const char* getBroadcastAddress(const char* interfaceName, bool prefix = false);
+
+  /**
+   * Returns a socket passed by the service manager, as systemd does with
+   * socket activation (LISTEN_PID and LISTEN_FDS). The socket is already
+   * bound when the process starts, so no packet sent during startup is lost.
+   * @param port The port the socket must be bound to.
+   * @return The UDP socket bound to the port or -1 if there is none.
+   */
+  static int getActivatedSocket(int port);
 
   /**
   * Determines the address that will broadcast to the wifi adapter.
+  * @param refresh Look the address up again instead of returning the one
+  *                found before, e.g. because the network changed.
   * @return The wifi broadcast address.
   */
-  static const char* getWifiBroadcastAddress();
+  static const char* getWifiBroadcastAddress(bool refresh = false);
 
 private:
   struct sockaddr* target;
+  struct sockaddr_in* mirrors; /**< The targets added. mirrors[i - 1] belongs to paths[i]. */
+  Path paths[maxNumOfPaths];
+  int numOfPaths;
   int sock;
+  int peer; /**< A socket connected to the target or -1 if the target is not connected. */
+  Stats stats;
+  int writeError; /**< The errno value of the last failure of write(). 0 if it succeeded. */
+  int epoll; /**< Created by the first call to wait(). */
+  int busyPollTime; /**< Upper bound of user space polling in wait() in µs. 0 if off. */
+  int pollTime; /**< The current adaptive user space polling time in µs. */
+  bool segmentation; /**< Can writeSegmented() use UDP_SEGMENT? Cleared when the kernel refuses it. */
   bool resolve(const char*, int, struct sockaddr_in*);
+
+  /**
+   * Sends a packet to all active paths with sendmmsg().
+   * @return Was the packet sent over at least one path?
+   */
+  bool writeMirrored(const char* data, const int len);
+
+  /**
+   * Sends datagrams of the same size to the target as separate packets with sendmmsg().
+   * @return Were all datagrams written?
+   */
+  bool writeSeparately(const char* data, const int len, int segmentSize);
+
+  /**
+   * Updates the scoreboard of a path after a send attempt. The caller counts
+   * the attempt in stats.
+   */
+  void updatePath(Path& path, bool success, int latency, long long now);
 };